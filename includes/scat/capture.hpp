@@ -0,0 +1,228 @@
+// Continuous capture of a single channel.
+//
+// capture runs two threads. The probe thread records samples from a signal::source with
+//  stream_channel and pushes them into a lock free ring buffer. The decoder thread pops them,
+//  thresholds them, run length encodes them and passes every finished run to a decoder callback.
+//  Memory use is bounded by the ring buffer, so a channel can be monitored for as long as needed
+//  and runs are decoded while the capture is still going.
+//
+// When the decoder falls behind the ring fills up, and capture_options::overrun decides whether
+//  the probe thread drops samples or waits for space. Either way the losses are counted in
+//  capture_statistics.
+#ifndef SCAT_HEADER_CAPTURE
+#define SCAT_HEADER_CAPTURE
+
+#include <scat/signal.hpp>
+#include <scat/utils.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace scat {
+namespace signal {
+
+enum class overrun_policy {
+    // Drop samples that do not fit in the ring. The probe thread keeps its timing, the decoder
+    // sees a shorter run than actually happened.
+    drop,
+
+    // Wait for the decoder to make space. The probe thread misses the time slots it spends
+    // waiting, which reach the decoder as MISSED_TIME_SLOT samples.
+    block,
+};
+
+struct capture_options {
+    // Samples at or above level are decoded as 1, everything else as 0. Missed time slots repeat
+    // the previous value.
+    int16_t level = 1;
+
+    // See samples_to_lengths
+    size_t minimum_gap = 6;
+
+    overrun_policy overrun = overrun_policy::drop;
+
+    // Pin the probe and decoder threads, see utils::pin_current_thread
+    bool pin = true;
+    size_t probe_core = 0;
+    size_t decoder_core = 1;
+};
+
+// capture_statistics
+//  Counters updated while capturing, safe to read from any thread.
+struct capture_statistics {
+    // Samples recorded by the probe thread
+    std::atomic<uint64_t> recorded{0};
+
+    // Samples that were dropped because the ring was full, overrun_policy::drop only
+    std::atomic<uint64_t> dropped{0};
+
+    // Samples that had to wait for space in the ring, overrun_policy::block only
+    std::atomic<uint64_t> blocked{0};
+
+    // Samples decoded, and how many of them were missed time slots
+    std::atomic<uint64_t> decoded{0};
+    std::atomic<uint64_t> missed{0};
+
+    // Runs passed to the decoder callback
+    std::atomic<uint64_t> runs{0};
+
+    // Most samples that were waiting in the ring at once, as seen by the decoder
+    std::atomic<uint64_t> high_water{0};
+};
+
+// capture<Source, Capacity>
+//  Captures a Source (see signal::source) until stop is called or the capture is destroyed.
+//  Capacity is the size of the ring in samples and must be a power of two.
+template<class Source, size_t Capacity = 65536>
+struct capture {
+public:
+    using sample_t = typename Source::sample_t;
+    using decoder_t = std::function<void(length<int16_t> const&)>;
+
+    // Samples the decoder thread pops at once
+    static const size_t BATCH_SIZE = 256;
+
+    // Value of a missed time slot, see prime_probe::reader_eviction_count::MISSED_TIME_SLOT
+    static const sample_t MISSED_TIME_SLOT = -1;
+
+private:
+    Source source;
+    capture_options options;
+    decoder_t decoder;
+
+    std::unique_ptr<utils::spsc_ring<sample_t, Capacity>> ring;
+    capture_statistics statistics;
+
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> recording{false};
+
+    std::thread probe_thread;
+    std::thread decoder_thread;
+
+public:
+    capture(Source source, decoder_t decoder, capture_options const& options = {}) :
+        source(source), options(options), decoder(decoder),
+        ring(std::make_unique<utils::spsc_ring<sample_t, Capacity>>())
+    {
+    }
+
+    capture(capture const&) = delete;
+    capture& operator=(capture const&) = delete;
+
+    ~capture(){
+        stop();
+    }
+
+    // start
+    //  Start the probe and decoder threads. A capture can only be started once.
+    void start(){
+        recording.store(true);
+
+        decoder_thread = std::thread([this]{
+            if(options.pin){
+                utils::pin_current_thread(options.decoder_core);
+            }
+            decode();
+        });
+
+        probe_thread = std::thread([this]{
+            if(options.pin){
+                utils::pin_current_thread(options.probe_core);
+            }
+            record();
+        });
+    }
+
+    // stop
+    //  Stop probing, then wait for the decoder to drain the ring and emit the final runs.
+    void stop(){
+        stopping.store(true);
+        if(probe_thread.joinable()){
+            probe_thread.join();
+        }
+
+        recording.store(false);
+        if(decoder_thread.joinable()){
+            decoder_thread.join();
+        }
+    }
+
+    capture_statistics const& get_statistics() const {
+        return statistics;
+    }
+
+private:
+    void record(){
+        source.stream(stopping, [&](sample_t sample){
+            statistics.recorded.fetch_add(1, std::memory_order_relaxed);
+
+            if(ring->try_push(sample)){
+                return;
+            }
+
+            if(options.overrun == overrun_policy::drop){
+                statistics.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            statistics.blocked.fetch_add(1, std::memory_order_relaxed);
+            while(!ring->try_push(sample)){
+                if(stopping.load(std::memory_order_relaxed)){
+                    return;
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    void decode(){
+        run_length_encoder<int16_t> encoder(options.minimum_gap);
+        sample_t batch[BATCH_SIZE];
+        int16_t value = 0;
+
+        auto emit = [&](length<int16_t> const& run){
+            statistics.runs.fetch_add(1, std::memory_order_relaxed);
+            decoder(run);
+        };
+
+        while(true){
+            // Check before popping, so that nothing pushed before the probe thread stopped is lost
+            bool done = !recording.load(std::memory_order_acquire);
+
+            auto waiting = ring->size();
+            if(waiting > statistics.high_water.load(std::memory_order_relaxed)){
+                statistics.high_water.store(waiting, std::memory_order_relaxed);
+            }
+
+            size_t count = ring->pop(batch, BATCH_SIZE);
+            if(count == 0){
+                if(done){
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+
+            uint64_t missed = 0;
+            for(size_t i = 0; i < count; i += 1){
+                missed += (batch[i] == MISSED_TIME_SLOT) ? 1 : 0;
+                value = threshold_sample(batch[i], options.level, value);
+                encoder.push(value, emit);
+            }
+
+            statistics.decoded.fetch_add(count, std::memory_order_relaxed);
+            statistics.missed.fetch_add(missed, std::memory_order_relaxed);
+        }
+
+        encoder.flush(emit);
+    }
+};
+
+} // namespace signal
+} // namespace scat
+
+#endif // SCAT_HEADER_CAPTURE
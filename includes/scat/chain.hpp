@@ -27,6 +27,16 @@ struct chain_t {
         return *p;
     }
 
+    // write
+    //  Store to p a value that depends on every previous read, so the store can not execute before
+    //  them. It is only ordered as far as execution goes: the store retires into the store buffer
+    //  and reaches the cache later, so timing a sequence of writes undercounts their cost.
+    template<class T>
+    inline void write(T* p){
+        *p = (T)this->value;
+        this->value ^= this->value << 8;
+    }
+
     ~chain_t(){
         if(((value << 1) | (value >> 1) | value) == 1){
             std::cerr << value << std::endl;
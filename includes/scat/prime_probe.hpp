@@ -3,15 +3,35 @@
 
 #include <scat/chain.hpp>
 #include <scat/utils.hpp>
+#include <scat/statistics.hpp>
 #include <scat/timer.hpp>
 #include <scat/set_construction.hpp>
 #include <scat/signal.hpp>
+#include <scat/profile.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <sys/mman.h>
+
 namespace scat {
 namespace prime_probe {
 
@@ -62,10 +82,65 @@ public:
         chain.read(&element->data);
     }
 
+    inline void write_element(element_t element, chain_t& chain){
+        chain.write(&element->data);
+    }
+
+    // flush_element
+    //  Evict element from every level of the cache. The flush has completed when this returns.
+    inline void flush_element(element_t element){
+        asm volatile ("clflush (%0)\n\tmfence" :: "r" (element) : "memory");
+    }
+
     std::vector<element_t>& get_elements(){
         return elements;
     }
 
+    // element_to_offset
+    //  Returns the offset of element from the start of the buffer, measured in elements. Unlike
+    //  elements, offsets remain meaningful between runs and can be stored (see profile).
+    size_t element_to_offset(element_t element){
+        return element - buffer.data();
+    }
+
+    // offset_to_element
+    //  Inverse of element_to_offset. Returns nullptr if offset is outside of the buffer.
+    element_t offset_to_element(size_t offset){
+        return offset < size ? &buffer[offset] : nullptr;
+    }
+
+    size_t get_buffer_size(){
+        return size * sizeof(element);
+    }
+
+    char const* get_page_type(){
+        return "4KiB";
+    }
+
+    // element_to_class
+    //  Returns the offset of element within its page, measured in elements. Elements in different
+    //  classes never share a cache set, so this is the part of the set index that is always known.
+    //  Works for any address, not only elements in the buffer.
+    size_t element_to_class(element_t element){
+        auto address = reinterpret_cast<uintptr_t>(element);
+        return (address % (VIRTUAL_ADDRESS_SIZE * sizeof(element))) / sizeof(element);
+    }
+
+    // get_elements
+    //  Same as get_elements(), but offset into element_class (see element_to_class).
+    std::vector<element_t> get_elements(size_t element_class){
+        std::vector<element_t> shifted(elements.size());
+
+        std::transform(
+            elements.begin(),
+            elements.end(),
+            shifted.begin(),
+            [&](auto element){return element + element_class;}
+        );
+
+        return shifted;
+    }
+
     std::vector<std::vector<element_t>> extend_elements(std::vector<element_t> const& elements){
         std::vector<std::vector<element_t>> extended;
         
@@ -89,6 +164,376 @@ public:
     }
 };
 
+// hugepage_cache
+//  A backend like cache, but with a buffer backed by 2 MiB huge pages.
+//
+//  Within a huge page the low 21 bits of the virtual address match the physical address, so every
+//  set index bit of the LLC is known. Elements that share a set index can be grouped up front, and
+//  construction only has to discover which slice each element maps to. get_elements therefore only
+//  returns elements with a set index of zero, one every SET_INDEX_SIZE bytes, and extend_elements
+//  generates the eviction sets for every other set index.
+//
+//  The buffer is allocated from the hugetlbfs pool (MAP_HUGETLB) if possible, otherwise transparent
+//  huge pages are requested with madvise. A successful madvise does not mean the kernel actually
+//  backs the buffer with huge pages (THP disabled, fragmentation), so after touching the buffer its
+//  AnonHugePages are checked in /proc/self/smaps. If any of it ended up on 4 KiB pages the backend
+//  falls back to the layout of cache, one candidate per 4 KiB page, and get_page_type says "4KiB".
+struct hugepage_cache {
+public:
+    using element = cache::element;
+    using element_t = element*;
+    using set_t = std::vector<element_t>;
+
+    static const size_t EVICTION_SET_SIZE = 16;
+
+    // Each set index class only receives one element every SET_INDEX_SIZE bytes, so the buffer
+    // needs to be several times larger than the LLC to find enough congruent elements per slice.
+    static const size_t CACHE_SIZE = 64 * 1024 * 1024;
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // Bytes spanned by the set index bits of a single LLC slice. 2048 sets of 64 byte cachelines on
+    // most Intel processors. Overestimating is safe, some extended eviction sets are duplicated.
+    static const size_t SET_INDEX_SIZE = 1 << 17;
+
+    static const size_t VIRTUAL_ADDRESS_SIZE = SET_INDEX_SIZE / sizeof(element);
+    static const size_t CACHELINE_SIZE = (1 << 6) / sizeof(element);
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    char const* page_type = "4KiB";
+
+    // Elements spanned by a class. VIRTUAL_ADDRESS_SIZE on huge pages, or
+    // cache::VIRTUAL_ADDRESS_SIZE if the buffer is backed by 4 KiB pages.
+    size_t class_size = VIRTUAL_ADDRESS_SIZE;
+
+    element* buffer;
+    std::vector<element_t> elements;
+    size_t size;
+
+public:
+    hugepage_cache(size_t size = CACHE_SIZE){
+        size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+        allocate(size);
+
+        size /= sizeof(element);
+        this->size = size;
+
+        for(size_t i = 0; i < size; i += 1){
+            new (&buffer[i]) element();
+            buffer[i].data = 1 + i;
+        }
+
+        // Transparent huge pages are only allocated when the memory is first touched
+        if(std::strcmp(page_type, "2MiB-thp") == 0 && !is_huge_page_backed()){
+            std::cerr << "Buffer is not backed by transparent huge pages, falling back to 4KiB "
+                      << "pages" << std::endl;
+            page_type = "4KiB";
+        }
+
+        if(std::strcmp(page_type, "4KiB") == 0){
+            class_size = cache::VIRTUAL_ADDRESS_SIZE;
+        }
+
+        for(size_t i = 0; i < size; i += class_size){
+            elements.push_back(&buffer[i]);
+        }
+    }
+
+    hugepage_cache(hugepage_cache const&) = delete;
+    hugepage_cache& operator=(hugepage_cache const&) = delete;
+
+    ~hugepage_cache(){
+        munmap(mapping, mapping_size);
+    }
+
+    inline void access_element(element_t element, chain_t& chain){
+        chain.read(&element->data);
+    }
+
+    inline void write_element(element_t element, chain_t& chain){
+        chain.write(&element->data);
+    }
+
+    // See cache::flush_element
+    inline void flush_element(element_t element){
+        asm volatile ("clflush (%0)\n\tmfence" :: "r" (element) : "memory");
+    }
+
+    std::vector<element_t>& get_elements(){
+        return elements;
+    }
+
+    // See cache::element_to_offset
+    size_t element_to_offset(element_t element){
+        return element - buffer;
+    }
+
+    // See cache::offset_to_element
+    element_t offset_to_element(size_t offset){
+        return offset < size ? &buffer[offset] : nullptr;
+    }
+
+    size_t get_buffer_size(){
+        return size * sizeof(element);
+    }
+
+    // get_page_type
+    //  "2MiB-hugetlb", "2MiB-thp", or "4KiB" if the kernel did not back the buffer with huge pages.
+    char const* get_page_type(){
+        return page_type;
+    }
+
+    // element_to_class
+    //  See cache::element_to_class. On huge pages the class covers SET_INDEX_SIZE bytes, so target
+    //  addresses outside of the buffer must also be backed by huge pages for the class to be
+    //  meaningful.
+    size_t element_to_class(element_t element){
+        auto address = reinterpret_cast<uintptr_t>(element);
+        return (address % (class_size * sizeof(element))) / sizeof(element);
+    }
+
+    // See cache::get_elements(element_class)
+    std::vector<element_t> get_elements(size_t element_class){
+        std::vector<element_t> shifted(elements.size());
+
+        std::transform(
+            elements.begin(),
+            elements.end(),
+            shifted.begin(),
+            [&](auto element){return element + element_class;}
+        );
+
+        return shifted;
+    }
+
+    std::vector<std::vector<element_t>> extend_elements(std::vector<element_t> const& elements){
+        std::vector<std::vector<element_t>> extended;
+
+        for(size_t offset = 0; offset < class_size; offset += CACHELINE_SIZE){
+            std::vector<element_t> set(elements.size());
+
+            std::transform(
+                elements.begin(),
+                elements.end(),
+                set.begin(),
+                [&](auto element){return element + offset;}
+            );
+
+            extended.push_back(set);
+        }
+
+        return extended;
+    }
+
+private:
+    void allocate(size_t size){
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE;
+
+        mapping_size = size;
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+
+        if(mapping != MAP_FAILED){
+            page_type = "2MiB-hugetlb";
+            buffer = static_cast<element*>(mapping);
+            return;
+        }
+
+        // Fallback to transparent huge pages. Over allocate so the buffer can be aligned to a huge
+        // page boundary, and ask for huge pages before touching the memory.
+        mapping_size = size + HUGE_PAGE_SIZE;
+        mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, flags & ~MAP_POPULATE, -1, 0);
+
+        if(mapping == MAP_FAILED){
+            std::cerr << "Could not allocate hugepage_cache buffer" << std::endl;
+            std::abort();
+        }
+
+        auto address = reinterpret_cast<uintptr_t>(mapping);
+        address = (address + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+        buffer = reinterpret_cast<element*>(address);
+
+        if(madvise(buffer, size, MADV_HUGEPAGE) == 0){
+            page_type = "2MiB-thp";
+        } else {
+            std::cerr << "Huge pages unavailable, falling back to 4KiB pages" << std::endl;
+        }
+    }
+
+    // is_huge_page_backed
+    //  True if /proc/self/smaps reports the whole buffer as AnonHugePages. madvise splits the
+    //  mapping at the buffer's boundaries, so the mappings overlapping the buffer cover exactly it.
+    bool is_huge_page_backed(){
+        std::ifstream smaps("/proc/self/smaps");
+        if(!smaps){
+            return false;
+        }
+
+        auto begin = reinterpret_cast<uintptr_t>(buffer);
+        auto end = begin + size * sizeof(element);
+
+        bool overlaps = false;
+        uint64_t huge = 0;
+
+        std::string line;
+        while(std::getline(smaps, line)){
+            uintptr_t start = 0, stop = 0;
+            char dash = 0;
+
+            std::istringstream header(line);
+            if(header >> std::hex >> start >> dash >> stop && dash == '-'){
+                overlaps = start < end && begin < stop;
+                continue;
+            }
+
+            std::istringstream field(line);
+            std::string name;
+            uint64_t kilobytes = 0;
+            if(overlaps && field >> name >> kilobytes && name == "AnonHugePages:"){
+                huge += kilobytes * 1024;
+            }
+        }
+
+        return huge >= end - begin;
+    }
+};
+
+// access_order
+//  Order eviction_strategy walks a set in.
+enum class access_order {
+    // Every repetition walks the set from front to back.
+    forward,
+
+    // Odd repetitions walk the set from back to front.
+    alternating,
+};
+
+// eviction_strategy
+//  How a set is accessed to evict a congruent line, in the notation of Gruss et al. "Rowhammer.js:
+//  A Remote Software-Induced Fault Attack in JavaScript". Each repetition slides a window of
+//  distance (D) elements over the set, step (L) elements at a time, and accesses every window
+//  count (C) times. Overlapping windows access each element several times in quick succession,
+//  which keeps it in the cache under adaptive replacement policies with fewer total accesses.
+//
+//  The default, two forward repetitions with C = D = L = 1, accesses the whole set twice in order.
+struct eviction_strategy {
+    size_t repetitions = 2;
+    size_t count = 1;
+    size_t distance = 1;
+    size_t step = 1;
+
+    access_order order = access_order::forward;
+
+    // Write to the elements instead of reading them
+    bool write = false;
+
+    // get_accesses
+    //  Number of element accesses for a set of size elements.
+    size_t get_accesses(size_t size) const {
+        size_t window = std::min(distance, size);
+        if(window == 0 || step == 0){
+            return 0;
+        }
+
+        size_t windows = (size - window + step - 1) / step + 1;
+        return repetitions * windows * count * window;
+    }
+};
+
+// access_pattern
+//  Access the random access range [begin, end) as described by strategy.
+template<class Backend, class Iterator>
+inline void access_pattern(
+    Backend& backend,
+    Iterator begin,
+    Iterator end,
+    eviction_strategy const& strategy,
+    chain_t& chain
+){
+    size_t size = end - begin;
+    size_t window = std::min(strategy.distance, size);
+    size_t step = std::max(strategy.step, (size_t)1);
+
+    if(window == 0){
+        return;
+    }
+
+    for(size_t repetition = 0; repetition < strategy.repetitions; repetition += 1){
+        bool reverse = (strategy.order == access_order::alternating) && (repetition % 2 == 1);
+
+        for(size_t start = 0; ; start += step){
+            // The last window always ends at the end of the set
+            start = std::min(start, size - window);
+
+            for(size_t c = 0; c < strategy.count; c += 1){
+                for(size_t d = 0; d < window; d += 1){
+                    size_t index = reverse ? (size - 1 - start - d) : (start + d);
+
+                    if(strategy.write){
+                        backend.write_element(begin[index], chain);
+                    } else {
+                        backend.access_element(begin[index], chain);
+                    }
+                }
+            }
+
+            if(start + window == size){
+                break;
+            }
+        }
+    }
+}
+
+// strategy_tuning
+//  Result of evicter::autotune, see there.
+struct strategy_tuning {
+    eviction_strategy strategy;
+
+    // Fraction of trials in which the witness was evicted
+    double rate = 0;
+
+    // Fraction of trials in which the set evicted the witness with one of its elements removed
+    double false_rate = 0;
+
+    // Median ticks spent priming the set
+    double cost = 0;
+};
+
+// threshold_calibration
+//  Result of evicter::calibrate_threshold.
+struct threshold_calibration {
+    uint64_t threshold = 0;
+
+    // Otsu's separation of the hit and miss latencies, see statistics::histogram::otsu
+    double separation = 0;
+
+    // Fraction of the known hits and misses that threshold classifies wrongly
+    double error_rate = 1;
+
+    // Samples taken of hits and of misses each
+    size_t samples = 0;
+
+    // True if sampling stopped early because the threshold settled
+    bool stable = false;
+};
+
+// threshold_event
+//  A recalibration made by a reader tracking its threshold, see reader_eviction_count::adaptive.
+struct threshold_event {
+    // Latencies the reader had tracked when it recalibrated
+    uint64_t latencies = 0;
+
+    uint64_t previous = 0;
+    uint64_t threshold = 0;
+
+    // Otsu's separation of the tracked latencies, see statistics::histogram::otsu
+    double separation = 0;
+
+    // False if the latencies were not clearly bimodal and the threshold was kept
+    bool applied = false;
+};
+
 template<class Backend, class Timer>
 struct evicter {
 public:
@@ -102,39 +547,77 @@ public:
     Backend* backend;
     Timer* timer;
 
+    // Samples are kept on the stack, sample_count is capped at this
+    static const size_t SAMPLE_CAPACITY = 16;
+
+    // calibrate_threshold's histogram covers CALIBRATION_BINS * CALIBRATION_BIN_WIDTH ticks
+    static const size_t CALIBRATION_BINS = 512;
+    static const size_t CALIBRATION_BIN_WIDTH = 4;
+
+    // calibrate_threshold samples this many hits and misses per round, and stops once the
+    // threshold has not moved for CALIBRATION_STABLE_ROUNDS rounds
+    static const size_t CALIBRATION_ROUND = 8;
+    static const size_t CALIBRATION_STABLE_ROUNDS = 3;
+
     // TODO: Allow for configuration
+    // Capped at SAMPLE_CAPACITY. Zero skips sampling, every access then times as 0 (a hit).
     size_t sample_count = 5;
     float sample_point = 0.5;
 
     ticks_t threshold = 0;
 
-    float calibration_separation = 0.2;
-    size_t calibration_samples = 50;
+    // Maximum number of witnesses that set_evicts_batch can test at once
+    static const size_t BATCH_SIZE = 64;
+
+    // Most hits and misses calibrate_threshold samples each
+    size_t calibration_samples = 64;
+
+    // calibrate_threshold only stops early, and only trusts its threshold, below these error rates
+    double calibration_stable_error = 0.05;
+    double calibration_maximum_error = 0.25;
+
+    // Result of the last call to calibrate_threshold
+    threshold_calibration calibration;
+
+    // How sets are accessed to evict the witness during construction
+    eviction_strategy strategy;
+
+    // Extra accesses a reader makes after timing each probe, see reader_eviction_count::strategy.
+    // None by default.
+    eviction_strategy probe_strategy = {0};
+
+    // Sets and trials per set that autotune measures each strategy on
+    static const size_t TUNING_SETS = 8;
+    static const size_t TUNING_TRIALS = 16;
+
+    // autotune picks the cheapest strategy whose eviction rate is within tuning_tolerance of the
+    // best strategy, and at least tuning_minimum_rate.
+    double tuning_tolerance = 0.02;
+    double tuning_minimum_rate = 0.9;
 
 public:
     evicter(Backend* backend, Timer* timer, chain_t& chain) :
         backend(backend), timer(timer){
-        // TODO: Setup method of memoizing threshold configuration
         threshold = calibrate_threshold(chain);
     }
 
+    // Skip calibration and use a previously calibrated threshold, see profile.
+    evicter(Backend* backend, Timer* timer, ticks_t threshold) :
+        backend(backend), timer(timer), threshold(threshold){
+    }
+
     // evict_and_time
     //  Given a set of elements from backend, access each element to try evict the witness.
     //  Then time how long it take to access the witness.
     ticks_t evict_and_time(set_t& set, element_t witness, chain_t& chain){
-        return scat::utils::sample(sample_point, sample_count, [&]{
+        return statistics::sample<SAMPLE_CAPACITY>(sample_point, sample_count, [&]{
             // Access the element in case it's not in the cache to begin with
             backend->access_element(witness, chain);
 
             // For whatever reason accessing elements once isn't guaranteed to cache them, accessing
-            // them twice seems to be sufficient in most of my tests (devast8a). If we could drop
-            // this to a single read or write it would probably drop the eviction set expansion by
-            // almost half.
-            for(size_t i = 0; i < 2; i += 1){
-                for(auto element : set){
-                    backend->access_element(element, chain);
-                }
-            }
+            // them twice seems to be sufficient in most of my tests (devast8a). The default
+            // strategy does exactly that, autotune can find a cheaper one for the running CPU.
+            prime(set, chain);
 
             auto start = timer->get_ticks(chain);
             backend->access_element(witness, chain);
@@ -148,90 +631,734 @@ public:
         return evict_and_time(set, witness, chain) >= threshold;
     }
 
-protected:
-    // calibrate_threshold
-    //  Automatically find a suitable value that will allow us to distinguish
-    //  between a cache hit and a cache miss. So that given the time to access
-    //  a piece of memory we can determine if 1t was cached or not.
-    ticks_t calibrate_threshold(chain_t& chain){
-        auto elements = backend->get_elements();
+    // set_evicts_batch
+    //  Given a set of elements from backend, determine which of up to BATCH_SIZE witnesses that set
+    //  can evict. The set is primed once per sample for all witnesses, rather than once per witness.
+    //
+    //  Returns a bitmask, bit i is set if witnesses[i] took at least threshold to access. Witnesses
+    //  can also evict each other when more than EVICTION_SET_SIZE of them are congruent, which is
+    //  common when the cache has few sets, so a set bit only means that the set may evict the
+    //  witness. Confirm each one with set_evicts, as eviction_set_builder::phase_collect does.
+    uint64_t set_evicts_batch(
+        set_t& set,
+        element_t const* witnesses,
+        size_t count,
+        chain_t& chain
+    ){
+        count = std::min(count, (size_t)BATCH_SIZE);
+        size_t samples = std::min(sample_count, (size_t)SAMPLE_CAPACITY);
 
-        // Run two experiments where we access each element in order and then access
-        //  the last element, and hope it is still cached because we just accessed it
-        //  the first element, and hope it is evicted because elements should fill the entire cache.
-        auto hit = scat::utils::sample(1.0 - calibration_separation, calibration_samples, [&]{
-            return evict_and_time(elements, elements.back(), chain);
-        });
-        auto miss = scat::utils::sample(calibration_separation, calibration_samples, [&]{
-            return evict_and_time(elements, elements.front(), chain);
-        });
+        // times[witness][sample]
+        statistics::sample_buffer<ticks_t, SAMPLE_CAPACITY> times[BATCH_SIZE];
 
-        if(hit >= miss){
-            std::cerr << "Could not calibrate an eviction threshold" << std::endl;
-            // TODO: Communicate errors in a better way
-            return 0;
+        for(size_t sample = 0; sample < samples; sample += 1){
+            // Access the witnesses in case they're not in the cache to begin with
+            for(size_t i = 0; i < count; i += 1){
+                backend->access_element(witnesses[i], chain);
+            }
+
+            prime(set, chain);
+
+            // Accessing a witness can only evict elements that are congruent with it, any other
+            // witness congruent with it has already been evicted by the set.
+            for(size_t i = 0; i < count; i += 1){
+                auto start = timer->get_ticks(chain);
+                backend->access_element(witnesses[i], chain);
+                times[i].push(timer->get_ticks(chain) - start);
+            }
         }
 
-        auto threshold = hit + (miss - hit) / 2;
-        return threshold;
+        uint64_t evicted = 0;
+        for(size_t i = 0; i < count; i += 1){
+            if(times[i].select(sample_point) >= threshold){
+                evicted |= (uint64_t)1 << i;
+            }
+        }
+
+        return evicted;
     }
 
-};
+    // prime
+    //  Access set following strategy.
+    inline void prime(set_t& set, chain_t& chain){
+        access_pattern(*backend, set.begin(), set.end(), strategy, chain);
+    }
 
-// reader_eviction_count
-//  Counts the number of elements in a provided set that were evicted since the previous sample.
-template<class State>
-struct reader_eviction_count {
-public:
-    using backend_t = typename State::backend_t;
-    using sample_t = int16_t;
-    using ticks_t = typename State::timer_t::ticks_t;
-    using timer_t = typename State::timer_t;
+    // autotune
+    //  Measure how reliably and how cheaply each of get_strategies() evicts the witnesses of sets,
+    //  and switch strategy to the cheapest one that evicts reliably. A strategy is reliable if it
+    //  evicts, and falsely evicts with an element missing from the set, within tuning_tolerance
+    //  of the best strategies. The strategy is left unchanged if no strategy reaches
+    //  tuning_minimum_rate.
+    template<class WitnessedSet>
+    strategy_tuning autotune(std::vector<WitnessedSet> const& sets, chain_t& chain){
+        auto best = tune(sets, 1, chain, [&](set_t& set, eviction_strategy const& candidate){
+            access_pattern(*backend, set.begin(), set.end(), candidate, chain);
+        });
 
-    static const sample_t MISSED_TIME_SLOT = -1;
+        if(best.rate >= tuning_minimum_rate){
+            strategy = best.strategy;
+        }
+        return best;
+    }
 
-public:
-    size_t sample_count = 10000;
-    ticks_t sample_length = 3000;
-    ticks_t threshold = 130;
+    // autotune_probe
+    //  Like autotune, but for probe_strategy. A probe accesses the set once in order before the
+    //  probe strategy, so a strategy of zero repetitions is a candidate.
+    template<class WitnessedSet>
+    strategy_tuning autotune_probe(std::vector<WitnessedSet> const& sets, chain_t& chain){
+        auto best = tune(sets, 0, chain, [&](set_t& set, eviction_strategy const& candidate){
+            for(auto element : set){
+                backend->access_element(element, chain);
+            }
+            access_pattern(*backend, set.begin(), set.end(), candidate, chain);
+        });
 
-public:
-    void set_sample_length(ticks_t sample_length){
-        this->sample_length = sample_length;
+        if(best.rate >= tuning_minimum_rate){
+            probe_strategy = best.strategy;
+        }
+        return best;
     }
 
-    void set_sample_length(std::chrono::nanoseconds sample_length){
-        set_sample_length(timer::realtime_to_ticks<timer_t>(sample_length));
-    }
+    // get_strategies
+    //  The candidates considered by autotune, with at least minimum_repetitions repetitions.
+    static std::vector<eviction_strategy> get_strategies(size_t minimum_repetitions){
+        // C, D, L. The first is a plain walk over the set, the rest are overlapping windows.
+        static const size_t WINDOWS[][3] = {{1, 1, 1}, {2, 2, 1}, {1, 2, 1}, {2, 3, 2}, {1, 4, 2}};
 
-    void set_recording_length(ticks_t recording_length){
-        this->sample_count = (recording_length / this->sample_length);
-    }
+        std::vector<eviction_strategy> strategies;
+        if(minimum_repetitions == 0){
+            strategies.push_back({0});
+        }
 
-    void set_recording_length(std::chrono::nanoseconds recording_length){
-        set_recording_length(timer::realtime_to_ticks<timer_t>(recording_length));
+        for(size_t repetitions = std::max(minimum_repetitions, (size_t)1); repetitions <= 3;
+            repetitions += 1){
+            for(auto& window : WINDOWS){
+                for(auto order : {access_order::forward, access_order::alternating}){
+                    for(bool write : {false, true}){
+                        eviction_strategy candidate;
+                        candidate.repetitions = repetitions;
+                        candidate.count = window[0];
+                        candidate.distance = window[1];
+                        candidate.step = window[2];
+                        candidate.order = order;
+                        candidate.write = write;
+                        strategies.push_back(candidate);
+                    }
+                }
+            }
+        }
+
+        return strategies;
     }
 
-    // read_channel
-    //  Return a vector of samples obtained by repeatedly calling probe on a given channel.
-    //
-    //  This function isn't intended to be directly used by client code, instead clients should use
-    //  scat::signal::source or scat::signal::source_group, which wraps this class.
-    std::vector<sample_t> read_channel(
-        State& state,
-        channel_t channel,
-        chain_t& chain
+private:
+    // tune
+    //  Measure every candidate strategy, primed through prime(set, candidate), and return the
+    //  cheapest one that evicts reliably. The measured cost of a strategy that writes misses the
+    //  stores still draining from the store buffer (see chain_t::write), so costs are only compared
+    //  between strategies that read. A writing strategy is picked only if none that reads is
+    //  reliable.
+    template<class WitnessedSet, class Prime>
+    strategy_tuning tune(
+        std::vector<WitnessedSet> const& sets,
+        size_t minimum_repetitions,
+        chain_t& chain,
+        Prime&& prime
     ){
-        std::vector<sample_t> samples;
-        samples.reserve(sample_count);
+        std::vector<strategy_tuning> results;
+        for(auto& candidate : get_strategies(minimum_repetitions)){
+            results.push_back(measure(sets, candidate, chain, prime));
+        }
 
-        size_t iterations = sample_count / 2;
-        bool odd_sample_count = sample_count % 2 == 1;
+        double best_rate = 0;
+        double best_false_rate = 1;
+        for(auto& result : results){
+            best_rate = std::max(best_rate, result.rate);
+            best_false_rate = std::min(best_false_rate, result.false_rate);
+        }
 
-        auto& set = state.sets[channel];
+        strategy_tuning best;
+        best.cost = -1;
+        for(auto& result : results){
+            bool reliable =
+                result.rate + tuning_tolerance >= best_rate &&
+                result.false_rate <= best_false_rate + tuning_tolerance;
+            bool cheaper = (result.strategy.write != best.strategy.write) ?
+                !result.strategy.write : result.cost < best.cost;
+            if(reliable && (best.cost < 0 || cheaper)){
+                best = result;
+            }
+        }
 
-        // We don't want to probe in the same order every time.
-        // Usually this would not be a problem, the sets we are given are defined as being the
+        return best;
+    }
+
+    // measure
+    //  Eviction rate, false eviction rate and median priming cost of candidate over the first
+    //  TUNING_SETS sets.
+    template<class WitnessedSet, class Prime>
+    strategy_tuning measure(
+        std::vector<WitnessedSet> const& sets,
+        eviction_strategy const& candidate,
+        chain_t& chain,
+        Prime& prime
+    ){
+        statistics::p2_quantile cost(0.5);
+        size_t evicted = 0;
+        size_t false_evicted = 0;
+        size_t trials = 0;
+
+        for(size_t i = 0; i < std::min(sets.size(), (size_t)TUNING_SETS); i += 1){
+            set_t set = sets[i].elements;
+            auto witness = sets[i].witness;
+
+            if(set.empty()){
+                continue;
+            }
+
+            for(size_t trial = 0; trial < TUNING_TRIALS; trial += 1){
+                backend->access_element(witness, chain);
+
+                auto start = timer->get_ticks(chain);
+                prime(set, candidate);
+                auto primed = timer->get_ticks(chain);
+                backend->access_element(witness, chain);
+                auto end = timer->get_ticks(chain);
+
+                cost.add((double)(ticks_t)(primed - start));
+                evicted += ((ticks_t)(end - primed) >= threshold) ? 1 : 0;
+
+                // Without one of its elements the set must not evict the witness, otherwise the
+                // contract phase removes elements the set needs. The removed element is still
+                // cached, as it is while contracting.
+                set_t subset = set;
+                subset.erase(subset.begin() + trial % set.size());
+
+                backend->access_element(witness, chain);
+                prime(subset, candidate);
+                auto subset_primed = timer->get_ticks(chain);
+                backend->access_element(witness, chain);
+                auto subset_end = timer->get_ticks(chain);
+
+                false_evicted += ((ticks_t)(subset_end - subset_primed) >= threshold) ? 1 : 0;
+                trials += 1;
+            }
+        }
+
+        strategy_tuning result;
+        result.strategy = candidate;
+        result.rate = (trials == 0) ? 0 : (double)evicted / trials;
+        result.false_rate = (trials == 0) ? 0 : (double)false_evicted / trials;
+        result.cost = cost.get();
+        return result;
+    }
+
+protected:
+    // calibrate_threshold
+    //  Automatically find a suitable value that will allow us to distinguish
+    //  between a cache hit and a cache miss. So that given the time to access
+    //  a piece of memory we can determine if 1t was cached or not.
+    //
+    //  Hit and miss latencies are collected into histograms in rounds, and the threshold is chosen
+    //  with Otsu's method over both. Sampling stops once the threshold settles with a low error
+    //  rate, or after calibration_samples of each. The details are kept in calibration.
+    ticks_t calibrate_threshold(chain_t& chain){
+        using histogram_t = statistics::histogram<CALIBRATION_BINS>;
+
+        auto elements = backend->get_elements();
+
+        histogram_t hits(CALIBRATION_BIN_WIDTH);
+        histogram_t misses(CALIBRATION_BIN_WIDTH);
+
+        calibration = {};
+        size_t stable_rounds = 0;
+
+        while(calibration.samples < calibration_samples){
+            // Access each element in order and then access either the last element, and hope it
+            //  is still cached because we just accessed it, or the first element, and hope it is
+            //  evicted because elements should fill the entire cache.
+            for(size_t i = 0; i < CALIBRATION_ROUND; i += 1){
+                hits.add(evict_and_time(elements, elements.back(), chain));
+                misses.add(evict_and_time(elements, elements.front(), chain));
+            }
+            calibration.samples += CALIBRATION_ROUND;
+
+            histogram_t all = hits;
+            all.merge(misses);
+            auto split = all.otsu();
+
+            // Settled if the threshold moved by at most a bin
+            bool settled =
+                split.threshold <= calibration.threshold + CALIBRATION_BIN_WIDTH &&
+                calibration.threshold <= split.threshold + CALIBRATION_BIN_WIDTH;
+            stable_rounds = settled ? stable_rounds + 1 : 0;
+
+            calibration.threshold = split.threshold;
+            calibration.separation = split.separation;
+            calibration.error_rate = (double)(
+                (hits.size() - hits.count_below(split.threshold)) +
+                misses.count_below(split.threshold)
+            ) / all.size();
+
+            if(stable_rounds + 1 >= CALIBRATION_STABLE_ROUNDS &&
+                calibration.error_rate <= calibration_stable_error){
+                calibration.stable = true;
+                break;
+            }
+        }
+
+        if(calibration.threshold == 0 || calibration.error_rate > calibration_maximum_error){
+            std::cerr << "Could not calibrate a reliable eviction threshold, "
+                      << calibration.error_rate * 100 << "% of samples misclassified" << std::endl;
+            // TODO: Communicate errors in a better way
+        }
+
+        return calibration.threshold;
+    }
+
+};
+
+// link_set
+//  Link the elements of set into a circular doubly linked list through element::next and
+//  element::prev, in the order of set. Writes to every element, so it also brings the set into the
+//  cache. An element can only be linked into one list at a time.
+template<class Set>
+void link_set(Set const& set){
+    size_t size = set.size();
+
+    for(size_t i = 0; i < size; i += 1){
+        set[i]->next = set[(i + 1) % size];
+        set[i]->prev = set[(i + size - 1) % size];
+    }
+}
+
+// traverse<Forward>
+//  Follow count links from element, through next if Forward and prev otherwise, and return the
+//  element reached. Each load depends on the previous one so the processor can not overlap them.
+template<bool Forward, class Element>
+inline Element* traverse(Element* element, size_t count){
+    for(size_t i = 0; i < count; i += 1){
+        element = Forward ? element->next : element->prev;
+    }
+
+    // Keep the loads alive
+    asm volatile ("" :: "r" (element));
+    return element;
+}
+
+// linked_evicter
+//  An evicter that primes eviction sets by chasing the pointers of a linked list (see link_set)
+//  rather than iterating a vector through chain_t. Accessing the set twice becomes a forward then
+//  a backward traversal.
+//
+//  Only works with backends whose elements are cache::element. Linking writes to the elements, so
+//  the same elements must not be tested from several threads at once, construct with a single
+//  thread (eviction_set_options::thread_count). The access pattern is fixed, evicter::strategy is
+//  ignored.
+template<class Backend, class Timer>
+struct linked_evicter : public evicter<Backend, Timer> {
+public:
+    using base_t = evicter<Backend, Timer>;
+    using ticks_t = typename base_t::ticks_t;
+    using set_t = typename base_t::set_t;
+    using element_t = typename base_t::element_t;
+
+    using base_t::base_t;
+
+public:
+    // See evicter::evict_and_time
+    ticks_t evict_and_time(set_t& set, element_t witness, chain_t& chain){
+        link_set(set);
+
+        return statistics::sample<base_t::SAMPLE_CAPACITY>(
+            this->sample_point, this->sample_count, [&]{
+                this->backend->access_element(witness, chain);
+                prime(set);
+
+                auto start = this->timer->get_ticks(chain);
+                this->backend->access_element(witness, chain);
+                return this->timer->get_ticks(chain) - start;
+            }
+        );
+    }
+
+    // See evicter::set_evicts
+    ticks_t set_evicts(set_t& set, element_t witness, chain_t& chain){
+        return evict_and_time(set, witness, chain) >= this->threshold;
+    }
+
+    // See evicter::set_evicts_batch, the set is only linked once per batch.
+    uint64_t set_evicts_batch(
+        set_t& set,
+        element_t const* witnesses,
+        size_t count,
+        chain_t& chain
+    ){
+        count = std::min(count, (size_t)base_t::BATCH_SIZE);
+        size_t samples = std::min(this->sample_count, (size_t)base_t::SAMPLE_CAPACITY);
+
+        statistics::sample_buffer<ticks_t, base_t::SAMPLE_CAPACITY> times[base_t::BATCH_SIZE];
+
+        link_set(set);
+
+        for(size_t sample = 0; sample < samples; sample += 1){
+            for(size_t i = 0; i < count; i += 1){
+                this->backend->access_element(witnesses[i], chain);
+            }
+
+            prime(set);
+
+            for(size_t i = 0; i < count; i += 1){
+                auto start = this->timer->get_ticks(chain);
+                this->backend->access_element(witnesses[i], chain);
+                times[i].push(this->timer->get_ticks(chain) - start);
+            }
+        }
+
+        uint64_t evicted = 0;
+        for(size_t i = 0; i < count; i += 1){
+            if(times[i].select(this->sample_point) >= this->threshold){
+                evicted |= (uint64_t)1 << i;
+            }
+        }
+
+        return evicted;
+    }
+
+private:
+    inline void prime(set_t& set){
+        if(set.empty()){
+            return;
+        }
+
+        traverse<true>(set.front(), set.size());
+        traverse<false>(set.back(), set.size());
+    }
+};
+
+// slot_controller
+//  Picks the shortest sample_length a reader can sustain on each channel. A reader with a
+//  controller (see reader_eviction_count::controller) reports how long the busy part of every time
+//  slot took and whether the slot was missed. Every window slots the controller compares the
+//  channel's missed slot rate with target_miss_rate:
+//
+//  - Above the target, sample_length grows by grow.
+//  - Otherwise sample_length shrinks to the busy time at percentile plus headroom, if that is
+//    shorter than the current length.
+//
+//  calibrate runs a few windows from maximum_length before a recording, later recordings keep
+//  adapting. Channels are tracked separately. A controller must only be used by one thread.
+struct slot_controller {
+public:
+    // Counters of a single channel
+    struct channel_statistics {
+        // Current sample_length, 0 until the channel is first recorded
+        uint64_t length = 0;
+
+        // Slots recorded and missed in total
+        uint64_t samples = 0;
+        uint64_t missed = 0;
+
+        // Busy ticks at percentile in the last finished window
+        double busy = 0;
+
+        // Windows after which sample_length changed
+        uint64_t adjustments = 0;
+
+        // Current window
+        size_t window_samples = 0;
+        size_t window_missed = 0;
+        statistics::p2_quantile window_busy;
+
+        double get_miss_rate() const {
+            return (samples > 0) ? (double)missed / samples : 0;
+        }
+    };
+
+public:
+    double target_miss_rate = 0.01;
+
+    // Percentile of the busy time sample_length must cover, and the margin added on top
+    double percentile = 0.99;
+    double headroom = 1.1;
+
+    // Factor sample_length grows by when too many slots are missed
+    double grow = 1.25;
+
+    uint64_t minimum_length = 64;
+    uint64_t maximum_length = 1 << 16;
+
+    // Slots per adjustment, and windows recorded by calibrate
+    size_t window = 1024;
+    size_t calibration_windows = 4;
+
+private:
+    std::vector<channel_statistics> channels;
+    channel_statistics* current = nullptr;
+
+public:
+    // begin
+    //  Called by the reader before recording channel, returns the sample_length to record with.
+    //  A channel that has not been recorded before starts at length.
+    uint64_t begin(channel_t channel, uint64_t length){
+        if(channel >= channels.size()){
+            channels.resize(channel + 1);
+        }
+
+        current = &channels[channel];
+        if(current->length == 0){
+            current->length = clamp(length);
+            current->window_busy = statistics::p2_quantile(percentile);
+        }
+        return current->length;
+    }
+
+    // observe
+    //  Called by the reader at the end of the busy part of every slot, with the ticks between the
+    //  start of the slot and now. Returns the sample_length to continue with.
+    uint64_t observe(uint64_t busy, bool missed){
+        auto& channel = *current;
+
+        channel.samples += 1;
+        channel.missed += missed ? 1 : 0;
+        channel.window_samples += 1;
+        channel.window_missed += missed ? 1 : 0;
+        channel.window_busy.add((double)busy);
+
+        if(channel.window_samples >= window){
+            adjust(channel);
+        }
+        return channel.length;
+    }
+
+    // calibrate
+    //  Record calibration_windows windows of channel with reader, starting from maximum_length,
+    //  and return the sample_length the controller settled on. The last adjustment is made from
+    //  the window before it, so the settled length is then validated on one more window without
+    //  adapting, and grown until a window meets target_miss_rate (or maximum_length is reached).
+    //  reader is left using this controller and the validated length.
+    template<class Reader, class State>
+    uint64_t calibrate(Reader& reader, State& state, channel_t channel, chain_t& chain){
+        if(channel < channels.size()){
+            channels[channel] = channel_statistics();
+        }
+
+        auto sample_count = reader.sample_count;
+
+        reader.controller = this;
+        reader.sample_length = maximum_length;
+        reader.sample_count = window * calibration_windows;
+        reader.record_channel(state, channel, chain, [](typename Reader::sample_t){});
+
+        // Validate without the controller, which would adjust at the end of the window
+        auto& settled = channels[channel];
+        reader.controller = nullptr;
+        reader.sample_count = window;
+
+        while(true){
+            size_t missed = 0;
+            reader.sample_length = settled.length;
+            reader.record_channel(state, channel, chain, [&](typename Reader::sample_t sample){
+                missed += (sample == Reader::MISSED_TIME_SLOT) ? 1 : 0;
+            });
+
+            if((double)missed / window <= target_miss_rate || settled.length >= maximum_length){
+                break;
+            }
+
+            settled.length = clamp(settled.length * grow);
+            settled.adjustments += 1;
+        }
+
+        reader.controller = this;
+        reader.sample_count = sample_count;
+        return settled.length;
+    }
+
+    channel_statistics const& get(channel_t channel) const {
+        return channels.at(channel);
+    }
+
+    size_t size() const {
+        return channels.size();
+    }
+
+private:
+    uint64_t clamp(double length) const {
+        return std::min(std::max((uint64_t)length, minimum_length), maximum_length);
+    }
+
+    void adjust(channel_statistics& channel){
+        double rate = (double)channel.window_missed / channel.window_samples;
+        channel.busy = channel.window_busy.get();
+
+        uint64_t length = channel.length;
+        if(rate > target_miss_rate){
+            length = clamp(channel.length * grow);
+        } else {
+            length = std::min(channel.length, clamp(channel.busy * headroom));
+        }
+
+        channel.adjustments += (length != channel.length) ? 1 : 0;
+        channel.length = length;
+
+        channel.window_samples = 0;
+        channel.window_missed = 0;
+        channel.window_busy = statistics::p2_quantile(percentile);
+    }
+};
+
+// reader_eviction_count
+//  Counts the number of elements in a provided set that were evicted since the previous sample.
+template<class State>
+struct reader_eviction_count {
+public:
+    using backend_t = typename State::backend_t;
+    using sample_t = int16_t;
+    using ticks_t = typename State::timer_t::ticks_t;
+    using timer_t = typename State::timer_t;
+
+    static const sample_t MISSED_TIME_SLOT = -1;
+
+public:
+    size_t sample_count = 10000;
+    ticks_t sample_length = 3000;
+    ticks_t threshold = 130;
+
+    // Extra accesses made after timing each probe, to make sure the set is cached again before the
+    // next sample. None by default, see evicter::autotune_probe.
+    eviction_strategy strategy = {0};
+
+    // Latencies are tracked in TRACKING_BINS bins of TRACKING_BIN_WIDTH ticks, longer latencies
+    // (usually interrupts) are not tracked.
+    static const size_t TRACKING_BINS = 128;
+    static const size_t TRACKING_BIN_WIDTH = 8;
+
+    // If true, every latency measured by probe is added to a running histogram and the threshold
+    // is recentered between its hit and miss modes every tracking_interval latencies. This follows
+    // drifting latencies (frequency scaling, co-tenant load) during long captures. Recalibration
+    // happens in the idle part of a time slot and is put off until a slot has room for it, so
+    // probes must leave as many ticks free as a recalibration takes (see recenter). A controller
+    // leaves that room by itself. Off by default.
+    bool adaptive = false;
+    size_t tracking_interval = 4096;
+
+    // The threshold is only moved if the tracked latencies separate at least this well and at
+    // least tracking_minimum_misses of them are misses. Quiet channels hardly miss at all and keep
+    // the previous threshold.
+    double tracking_minimum_separation = 0.75;
+    double tracking_minimum_misses = 0.01;
+
+    // The last threshold_event_capacity recalibrations, applied or not, oldest first. Older events
+    // are dropped so that endless recordings (stream_channel, signal::capture) stay bounded.
+    std::deque<threshold_event> threshold_events;
+    size_t threshold_event_capacity = 1024;
+
+    // Cost of a timer read, subtracted from every access latency before it is compared with
+    // threshold or tracked. Zero by default, see subtract_timer_overhead.
+    ticks_t timer_overhead = 0;
+
+    // If set, sample_length is picked per channel by the controller and adapted while recording.
+    // Shared between copies of the reader, so it must not be used by several threads at once
+    // (signal::find_first_parallel gives each worker a copy).
+    slot_controller* controller = nullptr;
+
+protected:
+    statistics::histogram<TRACKING_BINS> latencies{TRACKING_BIN_WIDTH};
+    uint64_t tracked = 0;
+    uint64_t untracked = 0;
+
+    // Ticks the last recalibration took, zero until the first one
+    ticks_t recenter_cost = 0;
+
+    // Channels sharing each time slot. sample_length covers all of them, the controller only sees
+    // the share of a single channel, see reader_interleaved.
+    size_t slot_channels = 1;
+
+public:
+    ticks_t get_threshold() const {
+        return threshold;
+    }
+
+    // subtract_timer_overhead
+    //  Subtract overhead (usually timer::characterization::overhead_median) from every access
+    //  latency, and from threshold to match. Samples do not change, but threshold and the tracked
+    //  latencies become the latency of the access alone, so they can be compared across timers.
+    //  reader_aggregate compares whole traversals with its own calibration and is not affected.
+    void subtract_timer_overhead(ticks_t overhead){
+        threshold += timer_overhead;
+        threshold = (threshold > overhead) ? threshold - overhead : 0;
+        timer_overhead = overhead;
+    }
+
+    // get_group_size
+    //  Number of channels read_channels records at once, see reader_interleaved.
+    size_t get_group_size() const {
+        return 1;
+    }
+
+    // prepare
+    //  Called by create once the eviction sets have been constructed, before the reader is handed
+    //  to the source group. Readers that calibrate or specialize themselves on the sets do so here.
+    void prepare(State& state, chain_t& chain){
+    }
+
+    void set_sample_length(ticks_t sample_length){
+        this->sample_length = sample_length;
+    }
+
+    void set_sample_length(std::chrono::nanoseconds sample_length){
+        set_sample_length(timer::realtime_to_ticks<timer_t>(sample_length));
+    }
+
+    void set_recording_length(ticks_t recording_length){
+        this->sample_count = (recording_length / this->sample_length);
+    }
+
+    void set_recording_length(std::chrono::nanoseconds recording_length){
+        set_recording_length(timer::realtime_to_ticks<timer_t>(recording_length));
+    }
+
+    // read_channel
+    //  Return a vector of samples obtained by repeatedly calling probe on a given channel.
+    //
+    //  This function isn't intended to be directly used by client code, instead clients should use
+    //  scat::signal::source or scat::signal::source_group, which wraps this class.
+    std::vector<sample_t> read_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain
+    ){
+        std::vector<sample_t> samples;
+        samples.reserve(sample_count);
+
+        record_channel(state, channel, chain, [&](sample_t sample){
+            samples.push_back(sample);
+        });
+
+        return samples;
+    }
+
+    // record_channel
+    //  Record sample_count samples like read_channel, but pass each one to sink as soon as it has
+    //  been recorded instead of storing it. Used to record into other formats, see
+    //  signal::record_runs and signal::record_packed.
+    template<class Sink>
+    void record_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        Sink&& sink
+    ){
+        size_t iterations = sample_count / 2;
+        bool odd_sample_count = sample_count % 2 == 1;
+
+        auto&& set = state.sets[channel];
+        begin(channel);
+
+        // We don't want to probe in the same order every time.
+        // Usually this would not be a problem, the sets we are given are defined as being the
         // minimal number of elements to evict every other element. That is the set perfectly fits
         // in the shared resource. However set construction is imperfect and accessing the entire
         // set, may result in some of the set's elements being evicted.
@@ -241,17 +1368,15 @@ public:
         // artificially raises the number of evicted elements.
         auto slot_start = state.timer->get_ticks(chain);
         for(size_t i = 0; i < iterations; i += 1){
-            samples.push_back(probe(state,  set.begin(),  set.end(), slot_start, chain));
+            sink(probe(state,  set.begin(),  set.end(), slot_start, chain));
             slot_start += sample_length;
 
-            samples.push_back(probe(state, set.rbegin(), set.rend(), slot_start, chain));
+            sink(probe(state, set.rbegin(), set.rend(), slot_start, chain));
             slot_start += sample_length;
         }
         if(odd_sample_count){
-            samples.push_back(probe(state,  set.begin(),  set.end(), slot_start, chain));
+            sink(probe(state,  set.begin(),  set.end(), slot_start, chain));
         }
-
-        return samples;
     }
 
     // read_channels
@@ -266,59 +1391,1377 @@ public:
     ){
         std::vector<std::vector<sample_t>> samples;
         for(auto channel: channels){
-            samples.push_back(read_channel(channel, chain));
+            samples.push_back(read_channel(state, channel, chain));
+        }
+        return samples;
+    }
+
+    // stream_channel
+    //  Like read_channel, but keeps probing until stop is set and passes every sample to sink as
+    //  soon as it has been recorded, instead of returning sample_count samples at the end. Time
+    //  spent in sink comes out of the next time slot.
+    //
+    //  This function isn't intended to be directly used by client code, see signal::capture.
+    template<class Sink>
+    void stream_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        std::atomic<bool> const& stop,
+        Sink&& sink
+    ){
+        auto&& set = state.sets[channel];
+        begin(channel);
+
+        // Alternate the order for the same reason as read_channel
+        auto slot_start = state.timer->get_ticks(chain);
+        while(!stop.load(std::memory_order_relaxed)){
+            sink(probe(state,  set.begin(),  set.end(), slot_start, chain));
+            slot_start += sample_length;
+
+            sink(probe(state, set.rbegin(), set.rend(), slot_start, chain));
+            slot_start += sample_length;
+        }
+    }
+
+protected:
+    // begin
+    //  Take the sample_length the controller picked for channel, if there is a controller.
+    inline void begin(channel_t channel){
+        if(controller != nullptr){
+            auto length = controller->begin(channel, sample_length / slot_channels);
+            sample_length = (ticks_t)(length * slot_channels);
+        }
+    }
+
+    // pace
+    //  Report the ticks since the start of the slot to the controller, if there is one, and take
+    //  the sample_length it returns. With adaptive, the time a recalibration takes is counted as
+    //  busy, so that the controller leaves room for recenter in every slot.
+    inline void pace(ticks_t busy, bool missed){
+        if(controller != nullptr){
+            busy += adaptive ? recenter_cost : 0;
+            auto length = controller->observe(busy / slot_channels, missed);
+            sample_length = (ticks_t)(length * slot_channels);
+        }
+    }
+
+    // miss
+    //  Report a missed slot to the controller. If that grew sample_length past the ticks already
+    //  spent, wait for the end of the grown slot. Otherwise the next slot would start ahead of the
+    //  timer, and every slot after it would look missed.
+    inline void miss(State& state, ticks_t slot_start, ticks_t time_end, chain_t& chain){
+        pace(time_end - slot_start, true);
+
+        while((time_end - slot_start) < sample_length){
+            time_end = state.timer->get_ticks(chain);
+        }
+    }
+
+    // track
+    //  Add a latency measured by probe to the running histogram.
+    inline void track(ticks_t latency){
+        if(latency < TRACKING_BINS * TRACKING_BIN_WIDTH){
+            latencies.add(latency);
+            untracked += 1;
+        }
+    }
+
+    // recenter
+    //  Called by probe while it waits for the end of its time slot, time_end is the tick count the
+    //  probe finished at and is moved past the recalibration. Once tracking_interval latencies
+    //  have been tracked, and if the rest of the slot fits the last recalibration's cost, move the
+    //  threshold to the Otsu threshold of the tracked latencies and halve the histogram so that
+    //  recent latencies dominate the next recalibration. The first recalibration is timed
+    //  whenever it is due, it may overrun its slot.
+    inline void recenter(State& state, ticks_t slot_start, ticks_t& time_end, chain_t& chain){
+        ticks_t busy = time_end - slot_start;
+        ticks_t remaining = (busy < sample_length) ? sample_length - busy : 0;
+        if(untracked < tracking_interval || recenter_cost > remaining){
+            return;
+        }
+
+        tracked += untracked;
+        untracked = 0;
+
+        auto split = latencies.otsu();
+        double misses = 1.0 - (double)latencies.count_below(split.threshold) / latencies.size();
+
+        threshold_event event;
+        event.latencies = tracked;
+        event.previous = threshold;
+        event.threshold = split.threshold;
+        event.separation = split.separation;
+        event.applied = split.separation >= tracking_minimum_separation &&
+            misses >= tracking_minimum_misses;
+
+        if(event.applied){
+            threshold = split.threshold;
+        }
+
+        if(threshold_events.size() >= threshold_event_capacity){
+            threshold_events.pop_front();
+        }
+        threshold_events.push_back(event);
+        latencies.decay();
+
+        auto recentered = state.timer->get_ticks(chain);
+        recenter_cost = recentered - time_end;
+        time_end = recentered;
+    }
+
+    // latency
+    //  Ticks from start to end without timer_overhead.
+    inline ticks_t latency(ticks_t start, ticks_t end) const {
+        ticks_t elapsed = end - start;
+        return (elapsed > timer_overhead) ? elapsed - timer_overhead : 0;
+    }
+
+    // count_evicted
+    //  Access every element in the range and return how many of them took at least threshold
+    //  ticks. time is the tick count the first access is timed from, and is updated to the tick
+    //  count after the last access.
+    template<class Iterator>
+    inline sample_t count_evicted(
+        State& state,
+        Iterator begin,
+        Iterator end,
+        ticks_t& time,
+        chain_t& chain
+    ){
+        sample_t count = 0;
+        auto time_start = time;
+        auto time_end = time;
+
+        for(auto it = begin; it != end; ++it){
+            state.backend->access_element(*it, chain);
+            time_end = state.timer->get_ticks(chain);
+
+            // Check if element was evicted
+            auto elapsed = latency(time_start, time_end);
+            if(elapsed >= threshold){
+                count += 1;
+            }
+
+            if(adaptive){
+                track(elapsed);
+            }
+
+            time_start = time_end;
+        }
+
+        time = time_end;
+        return count;
+    }
+
+    // probe
+    //  Return the number of elements in the provided range that have been evicted then busy wait
+    //  until the end of the timeslot.
+    //
+    //  Returns MISSED_TIME_SLOT if probe is called and the timeslot has already been missed or if
+    //  element accessing took longer than the timeslot.
+    template<class Iterator>
+    inline sample_t probe(
+        State& state,
+        Iterator begin,
+        Iterator end,
+        ticks_t slot_start,
+        chain_t& chain
+    ){
+        auto time_end = state.timer->get_ticks(chain);
+
+        // Check if previous timeslot overran and consumed out timeslot
+        if((time_end - slot_start) > sample_length){
+            miss(state, slot_start, time_end, chain);
+            return MISSED_TIME_SLOT;
+        }
+
+        sample_t count = count_evicted(state, begin, end, time_end, chain);
+
+        if(strategy.repetitions > 0){
+            access_pattern(*state.backend, begin, end, strategy, chain);
+            time_end = state.timer->get_ticks(chain);
+        }
+
+        // We might have missed our timeslot if our code was interrupted
+        if((time_end - slot_start) > sample_length){
+            miss(state, slot_start, time_end, chain);
+            return MISSED_TIME_SLOT;
+        }
+
+        pace(time_end - slot_start, false);
+
+        if(adaptive){
+            recenter(state, slot_start, time_end, chain);
+        }
+
+        // Spin until the end of our time slot
+        while((time_end - slot_start) < sample_length){
+            time_end = state.timer->get_ticks(chain);
+        }
+
+        return count;
+    }
+};
+
+// reader_linked_list
+//  Like reader_eviction_count, but each eviction set is linked into a circular list (see link_set)
+//  and probed by chasing pointers, forwards and backwards on alternate samples. Every access
+//  depends on the previous one, so accesses are serialized without chain_t and a probe takes less
+//  time, allowing a shorter sample_length.
+//
+//  Only works with backends whose elements are cache::element. A channel's elements are relinked
+//  at the start of every read_channel. reader_eviction_count::strategy is ignored.
+template<class State>
+struct reader_linked_list : public reader_eviction_count<State> {
+public:
+    using base_t = reader_eviction_count<State>;
+    using sample_t = typename base_t::sample_t;
+    using ticks_t = typename base_t::ticks_t;
+    using element_t = typename State::backend_t::element_t;
+
+    using base_t::MISSED_TIME_SLOT;
+
+public:
+    // See reader_eviction_count::read_channel
+    std::vector<sample_t> read_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain
+    ){
+        std::vector<sample_t> samples;
+        samples.reserve(this->sample_count);
+
+        record_channel(state, channel, chain, [&](sample_t sample){
+            samples.push_back(sample);
+        });
+
+        return samples;
+    }
+
+    // See reader_eviction_count::record_channel
+    template<class Sink>
+    void record_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        Sink&& sink
+    ){
+        auto&& set = state.sets[channel];
+        link_set(set);
+        this->begin(channel);
+
+        element_t first = set.empty() ? nullptr : set.front();
+        element_t last = set.empty() ? nullptr : set.back();
+
+        // Alternate the direction for the same reason reader_eviction_count alternates the order
+        auto slot_start = state.timer->get_ticks(chain);
+        for(size_t i = 0; i < this->sample_count; i += 1){
+            sink((i % 2 == 0) ?
+                probe<true>(state, first, set.size(), slot_start, chain) :
+                probe<false>(state, last, set.size(), slot_start, chain)
+            );
+            slot_start += this->sample_length;
+        }
+    }
+
+    // See reader_eviction_count::read_channels
+    std::vector<std::vector<sample_t>> read_channels(
+        State& state,
+        std::vector<channel_t>& channels,
+        chain_t& chain
+    ){
+        std::vector<std::vector<sample_t>> samples;
+        for(auto channel: channels){
+            samples.push_back(read_channel(state, channel, chain));
+        }
+        return samples;
+    }
+
+    // See reader_eviction_count::stream_channel
+    template<class Sink>
+    void stream_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        std::atomic<bool> const& stop,
+        Sink&& sink
+    ){
+        auto&& set = state.sets[channel];
+        link_set(set);
+        this->begin(channel);
+
+        element_t first = set.empty() ? nullptr : set.front();
+        element_t last = set.empty() ? nullptr : set.back();
+
+        auto slot_start = state.timer->get_ticks(chain);
+        while(!stop.load(std::memory_order_relaxed)){
+            sink(probe<true>(state, first, set.size(), slot_start, chain));
+            slot_start += this->sample_length;
+
+            sink(probe<false>(state, last, set.size(), slot_start, chain));
+            slot_start += this->sample_length;
+        }
+    }
+
+protected:
+    // probe<Forward>
+    //  See reader_eviction_count::probe. Starting at element, follow size links through next if
+    //  Forward and prev otherwise, timing each access.
+    template<bool Forward>
+    inline sample_t probe(
+        State& state,
+        element_t element,
+        size_t size,
+        ticks_t slot_start,
+        chain_t& chain
+    ){
+        sample_t count = 0;
+        auto time_start = state.timer->get_ticks(chain);
+        auto time_end = time_start;
+
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
+            return MISSED_TIME_SLOT;
+        }
+
+        for(size_t i = 0; i < size; i += 1){
+            element = Forward ? element->next : element->prev;
+
+            // The load must complete before the timer is read
+            asm volatile ("" :: "r" (element) : "memory");
+            time_end = state.timer->get_ticks(chain);
+
+            auto elapsed = this->latency(time_start, time_end);
+            if(elapsed >= this->threshold){
+                count += 1;
+            }
+
+            if(this->adaptive){
+                this->track(elapsed);
+            }
+
+            time_start = time_end;
+        }
+
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
+            return MISSED_TIME_SLOT;
+        }
+
+        this->pace(time_end - slot_start, false);
+
+        if(this->adaptive){
+            this->recenter(state, slot_start, time_end, chain);
+        }
+
+        while((time_end - slot_start) < this->sample_length){
+            time_end = state.timer->get_ticks(chain);
+        }
+
+        return count;
+    }
+};
+
+// reader_interleaved
+//  Like reader_eviction_count, but read_channels probes up to group_size channels in every time
+//  slot instead of recording the channels one after another, so the channels of a group are
+//  recorded over the same span of time.
+//
+//  sample_length is the slot of a single channel, a group of count channels is recorded with slots
+//  of sample_length * count so that the defaults fit. That takes as long as recording the channels
+//  one after another. Most of a slot is spent waiting for its end, so the time is saved with a
+//  slot_controller, which shrinks the group's slot to what probing the whole group takes. The
+//  controller paces every group under its first channel, with the slot's length and busy time
+//  divided by count, so the length it keeps is per channel as for reader_eviction_count. After
+//  a read sample_length is the per channel length the controller ended on.
+//
+//  Sets are probed in a rotating order and alternating direction, so that no set is always
+//  probed first, nor its elements always in the same order. A slot that overruns is
+//  MISSED_TIME_SLOT for every channel in the group.
+template<class State>
+struct reader_interleaved : public reader_eviction_count<State> {
+public:
+    using base_t = reader_eviction_count<State>;
+    using sample_t = typename base_t::sample_t;
+    using ticks_t = typename base_t::ticks_t;
+    // What state.sets[channel] returns, a set_view for state
+    using set_view_t = std::decay_t<decltype(std::declval<State&>().sets[0])>;
+
+    using base_t::MISSED_TIME_SLOT;
+
+    // Most channels probed in one time slot
+    static const size_t GROUP_CAPACITY = 64;
+
+public:
+    size_t group_size = 4;
+
+public:
+    size_t get_group_size() const {
+        return std::min(std::max(group_size, (size_t)1), (size_t)GROUP_CAPACITY);
+    }
+
+    // read_group
+    //  Record count channels starting at first from a single recording. Returns the samples of
+    //  each channel, result[channel][sample], with sample_count samples each.
+    std::vector<std::vector<sample_t>> read_group(
+        State& state,
+        channel_t const* first,
+        size_t count,
+        chain_t& chain
+    ){
+        count = std::min(count, (size_t)GROUP_CAPACITY);
+
+        std::vector<std::vector<sample_t>> samples(count);
+        std::vector<set_view_t> sets;
+        sets.reserve(count);
+
+        for(size_t i = 0; i < count; i += 1){
+            samples[i].resize(this->sample_count);
+            sets.push_back(state.sets[first[i]]);
+        }
+
+        // The group is paced as a whole, under its first channel. The controller keeps lengths per
+        // channel, so it sees a slot's length and busy time divided by the size of the group.
+        this->slot_channels = std::max(count, (size_t)1);
+        this->sample_length *= this->slot_channels;
+        if(count > 0){
+            this->begin(first[0]);
+        }
+
+        sample_t counts[GROUP_CAPACITY];
+
+        auto slot_start = state.timer->get_ticks(chain);
+        for(size_t sample = 0; sample < this->sample_count; sample += 1){
+            bool hit = (sample % 2 == 0) ?
+                probe_group<true>(state, sets.data(), count, sample, counts, slot_start, chain) :
+                probe_group<false>(state, sets.data(), count, sample, counts, slot_start, chain);
+
+            for(size_t i = 0; i < count; i += 1){
+                samples[i][sample] = hit ? counts[i] : MISSED_TIME_SLOT;
+            }
+            slot_start += this->sample_length;
+        }
+
+        // Back to the length of a single channel, keeping what the controller picked
+        this->sample_length /= this->slot_channels;
+        this->slot_channels = 1;
+        return samples;
+    }
+
+    // read_channels
+    //  See reader_eviction_count::read_channels. Channels are recorded get_group_size() at a time.
+    std::vector<std::vector<sample_t>> read_channels(
+        State& state,
+        std::vector<channel_t>& channels,
+        chain_t& chain
+    ){
+        std::vector<std::vector<sample_t>> samples;
+        samples.reserve(channels.size());
+
+        size_t group = get_group_size();
+        for(size_t i = 0; i < channels.size(); i += group){
+            auto recorded = read_group(
+                state, channels.data() + i, std::min(group, channels.size() - i), chain
+            );
+
+            for(auto& channel : recorded){
+                samples.push_back(std::move(channel));
+            }
+        }
+        return samples;
+    }
+
+protected:
+    // probe_group<Forward>
+    //  See reader_eviction_count::probe. Probe count sets, starting with sets[sample % count],
+    //  storing the number of evicted elements of sets[i] in counts[i]. Returns false if the time
+    //  slot was missed.
+    template<bool Forward>
+    inline bool probe_group(
+        State& state,
+        set_view_t const* sets,
+        size_t count,
+        size_t sample,
+        sample_t* counts,
+        ticks_t slot_start,
+        chain_t& chain
+    ){
+        auto time_end = state.timer->get_ticks(chain);
+
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
+            return false;
+        }
+
+        for(size_t j = 0; j < count; j += 1){
+            size_t i = (sample + j) % count;
+            auto& set = sets[i];
+
+            counts[i] = Forward ?
+                this->count_evicted(state, set.begin(), set.end(), time_end, chain) :
+                this->count_evicted(state, set.rbegin(), set.rend(), time_end, chain);
+
+            if(this->strategy.repetitions > 0){
+                access_pattern(*state.backend, set.begin(), set.end(), this->strategy, chain);
+                time_end = state.timer->get_ticks(chain);
+            }
+        }
+
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
+            return false;
+        }
+
+        this->pace(time_end - slot_start, false);
+
+        if(this->adaptive){
+            this->recenter(state, slot_start, time_end, chain);
+        }
+
+        while((time_end - slot_start) < this->sample_length){
+            time_end = state.timer->get_ticks(chain);
+        }
+
+        return true;
+    }
+};
+
+// reader_aggregate
+//  Like reader_eviction_count, but times the traversal of the whole set with a single pair of timer
+//  reads instead of timing every element. The number of evicted elements is estimated from the
+//  total with latency_table. Without a timer read between accesses a probe is much shorter,
+//  allowing a shorter sample_length, at the cost of only estimating the count.
+//
+//  latency_table is calibrated on channel 0 by prepare, which create calls before returning the
+//  source group. A reader that was not prepared calibrates on the first channel it records,
+//  unless latency_table has been set beforehand. The table is used for every channel after that,
+//  so all sets should be the same size. Calibration flushes elements of the set, the Backend must
+//  provide flush_element. reader_eviction_count::adaptive is ignored.
+template<class State>
+struct reader_aggregate : public reader_eviction_count<State> {
+public:
+    using base_t = reader_eviction_count<State>;
+    using sample_t = typename base_t::sample_t;
+    using ticks_t = typename base_t::ticks_t;
+
+    using base_t::MISSED_TIME_SLOT;
+
+    // calibrate keeps its samples on the stack, calibration_samples is capped at this
+    static const size_t CALIBRATION_CAPACITY = 16;
+
+public:
+    // latency_table[k] is the shortest traversal that is estimated as k evicted elements, it is
+    // empty until calibrated. latency_table[0] is always 0.
+    std::vector<ticks_t> latency_table;
+
+    // Traversals timed for each number of evicted elements, the median is used. calibrate takes at
+    // least one and at most CALIBRATION_CAPACITY, larger values are capped.
+    size_t calibration_samples = 9;
+    float calibration_point = 0.5;
+
+public:
+    // prepare
+    //  Calibrate latency_table on the first channel, see reader_eviction_count::prepare.
+    void prepare(State& state, chain_t& chain){
+        if(latency_table.size() < 2 && state.sets.size() > 0){
+            calibrate(state, 0, chain);
+        }
+    }
+
+    // See reader_eviction_count::read_channel
+    std::vector<sample_t> read_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain
+    ){
+        std::vector<sample_t> samples;
+        samples.reserve(this->sample_count);
+
+        record_channel(state, channel, chain, [&](sample_t sample){
+            samples.push_back(sample);
+        });
+
+        return samples;
+    }
+
+    // See reader_eviction_count::read_channels
+    std::vector<std::vector<sample_t>> read_channels(
+        State& state,
+        std::vector<channel_t>& channels,
+        chain_t& chain
+    ){
+        std::vector<std::vector<sample_t>> samples;
+        for(auto channel: channels){
+            samples.push_back(read_channel(state, channel, chain));
+        }
+        return samples;
+    }
+
+    // See reader_eviction_count::record_channel
+    template<class Sink>
+    void record_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        Sink&& sink
+    ){
+        size_t count = this->sample_count;
+        record_while(state, channel, chain, sink, [count](size_t i){ return i < count; });
+    }
+
+    // See reader_eviction_count::stream_channel
+    template<class Sink>
+    void stream_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        std::atomic<bool> const& stop,
+        Sink&& sink
+    ){
+        record_while(state, channel, chain, sink, [&stop](size_t){
+            return !stop.load(std::memory_order_relaxed);
+        });
+    }
+
+    // calibrate
+    //  Fill latency_table from a channel. For every number of evicted elements k, the set is
+    //  cached, k of its elements are flushed and the traversal is timed. Boundaries lie halfway
+    //  between the median traversal times of neighbouring counts.
+    void calibrate(State& state, channel_t channel, chain_t& chain){
+        auto&& set = state.sets[channel];
+        auto& backend = *state.backend;
+        size_t size = set.size();
+
+        std::vector<ticks_t> medians(size + 1);
+        for(size_t evicted = 0; evicted <= size; evicted += 1){
+            // statistics::sample returns zero for no samples, which would collapse the table
+            medians[evicted] = statistics::sample<CALIBRATION_CAPACITY>(
+                calibration_point, std::max(calibration_samples, (size_t)1), [&]{
+                    access_pattern(backend, set.begin(), set.end(), eviction_strategy(), chain);
+
+                    // Spread the flushed elements over the set
+                    for(size_t i = 0; i < evicted; i += 1){
+                        backend.flush_element(set[i * size / evicted]);
+                    }
+
+                    return traverse(state, set.begin(), set.end(), chain);
+                }
+            );
+        }
+
+        latency_table.assign(size + 1, 0);
+        for(size_t evicted = 1; evicted <= size; evicted += 1){
+            ticks_t boundary = medians[evicted - 1] +
+                (medians[evicted] - std::min(medians[evicted], medians[evicted - 1])) / 2;
+            latency_table[evicted] = std::max(boundary, latency_table[evicted - 1]);
+        }
+    }
+
+    // estimate
+    //  Number of evicted elements for a traversal that took total ticks.
+    inline sample_t estimate(ticks_t total) const {
+        auto boundary = std::upper_bound(latency_table.begin() + 1, latency_table.end(), total);
+        return (sample_t)(boundary - (latency_table.begin() + 1));
+    }
+
+protected:
+    // record_while
+    //  Record samples while more(i) is true for the i-th sample, passing each one to sink.
+    template<class Sink, class More>
+    void record_while(State& state, channel_t channel, chain_t& chain, Sink& sink, More more){
+        auto&& set = begin_channel(state, channel, chain);
+
+        // Alternate the order for the same reason reader_eviction_count does
+        auto slot_start = state.timer->get_ticks(chain);
+        for(size_t i = 0; more(i); i += 1){
+            sink((i % 2 == 0) ?
+                probe(state,  set.begin(),  set.end(), slot_start, chain) :
+                probe(state, set.rbegin(), set.rend(), slot_start, chain)
+            );
+            slot_start += this->sample_length;
+        }
+    }
+
+    // begin_channel
+    //  Calibrate on channel if latency_table has not been calibrated yet, and return its set.
+    decltype(auto) begin_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain
+    ){
+        if(latency_table.size() < 2){
+            calibrate(state, channel, chain);
+        }
+        this->begin(channel);
+        return state.sets[channel];
+    }
+
+    // traverse
+    //  Access every element in the range and return the ticks it took, used by calibrate.
+    template<class Iterator>
+    inline ticks_t traverse(State& state, Iterator begin, Iterator end, chain_t& chain){
+        auto time_start = state.timer->get_ticks(chain);
+        for(auto it = begin; it != end; ++it){
+            state.backend->access_element(*it, chain);
+        }
+        return state.timer->get_ticks(chain) - time_start;
+    }
+
+    // probe
+    //  See reader_eviction_count::probe
+    template<class Iterator>
+    inline sample_t probe(
+        State& state,
+        Iterator begin,
+        Iterator end,
+        ticks_t slot_start,
+        chain_t& chain
+    ){
+        auto time_end = state.timer->get_ticks(chain);
+
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
+            return MISSED_TIME_SLOT;
+        }
+
+        // The read that checked the slot also starts the traversal
+        auto time_start = time_end;
+        for(auto it = begin; it != end; ++it){
+            state.backend->access_element(*it, chain);
+        }
+        time_end = state.timer->get_ticks(chain);
+
+        sample_t count = estimate(time_end - time_start);
+
+        if(this->strategy.repetitions > 0){
+            access_pattern(*state.backend, begin, end, this->strategy, chain);
+            time_end = state.timer->get_ticks(chain);
+        }
+
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
+            return MISSED_TIME_SLOT;
+        }
+
+        this->pace(time_end - slot_start, false);
+
+        while((time_end - slot_start) < this->sample_length){
+            time_end = state.timer->get_ticks(chain);
+        }
+
+        return count;
+    }
+};
+
+enum class timing_mode {
+    // Time every access and count those at or above the threshold, see reader_eviction_count
+    element,
+
+    // Time the whole traversal, see reader_aggregate
+    aggregate,
+};
+
+// probe_kernel<Size, Forward, Mode>
+//  Traverse a set of exactly Size elements held in a std::array, in order if Forward and in
+//  reverse otherwise. The traversal is fully unrolled at compile time, so there is no loop bound
+//  and the elements are addressed directly rather than through iterators.
+//
+//  run returns the number of accesses that took at least threshold ticks with timing_mode::element
+//  and the ticks taken by the whole traversal with timing_mode::aggregate. Accesses are timed from
+//  time, which is updated to the tick count after the last access.
+template<size_t Size, bool Forward, timing_mode Mode>
+struct probe_kernel {
+    template<class Backend, class Timer, class Element, class Ticks>
+    static inline Ticks run(
+        Backend& backend,
+        Timer& timer,
+        std::array<Element, Size> const& set,
+        Ticks threshold,
+        Ticks& time,
+        chain_t& chain
+    ){
+        return run(backend, timer, set, threshold, time, chain, std::make_index_sequence<Size>());
+    }
+
+private:
+    template<class Backend, class Timer, class Element, class Ticks, size_t... Index>
+    static inline Ticks run(
+        Backend& backend,
+        Timer& timer,
+        std::array<Element, Size> const& set,
+        Ticks threshold,
+        Ticks& time,
+        chain_t& chain,
+        std::index_sequence<Index...>
+    ){
+        auto time_start = time;
+
+        if constexpr(Mode == timing_mode::aggregate){
+            (backend.access_element(set[Forward ? Index : Size - 1 - Index], chain), ...);
+            time = timer.get_ticks(chain);
+            return time - time_start;
+        } else {
+            Ticks count = 0;
+            ([&]{
+                backend.access_element(set[Forward ? Index : Size - 1 - Index], chain);
+                auto time_end = timer.get_ticks(chain);
+                count += ((time_end - time_start) >= threshold) ? 1 : 0;
+                time_start = time_end;
+            }(), ...);
+
+            time = time_start;
+            return count;
+        }
+    }
+};
+
+// prime_kernel<Size>
+//  Access every element of a std::array backed set once, fully unrolled, see probe_kernel.
+template<size_t Size>
+struct prime_kernel {
+    template<class Backend, class Element>
+    static inline void run(Backend& backend, std::array<Element, Size> const& set, chain_t& chain){
+        run(backend, set, chain, std::make_index_sequence<Size>());
+    }
+
+private:
+    template<class Backend, class Element, size_t... Index>
+    static inline void run(
+        Backend& backend,
+        std::array<Element, Size> const& set,
+        chain_t& chain,
+        std::index_sequence<Index...>
+    ){
+        (backend.access_element(set[Index], chain), ...);
+    }
+};
+
+// reader_unrolled
+//  Probes with probe_kernel instead of the generic loops of reader_eviction_count and
+//  reader_aggregate. A channel's set is copied into a std::array on the stack at the start of
+//  every recording, and every probe is a fully unrolled kernel specialized for the set size,
+//  direction and timing.
+//
+//  Kernels are instantiated for the set sizes in KERNEL_SIZES. prepare (called by create) picks
+//  the kernel for the size most constructed sets share, i.e. the measured associativity, and
+//  reports how many channels fall back to the generic reader with the same timing because their
+//  set has another size (see kernel_channels). With timing_mode::aggregate
+//  latency_table is calibrated as in reader_aggregate. reader_eviction_count::strategy is only
+//  unrolled if it is a plain repeated forward traversal, and adaptive thresholds always use the
+//  generic reader.
+template<class State>
+struct reader_unrolled : public reader_aggregate<State> {
+public:
+    using aggregate_t = reader_aggregate<State>;
+    using base_t = reader_eviction_count<State>;
+    using sample_t = typename base_t::sample_t;
+    using ticks_t = typename base_t::ticks_t;
+    using element_t = typename State::backend_t::element_t;
+
+    using base_t::MISSED_TIME_SLOT;
+
+    // Set sizes there is a kernel for, the associativities of common last level caches
+    using KERNEL_SIZES = std::index_sequence<4, 8, 11, 12, 16, 20, 24>;
+
+public:
+    timing_mode timing = timing_mode::element;
+
+    // Set size of the kernel picked by prepare, 0 if there is none
+    size_t kernel_size = 0;
+
+    // Channels whose set is kernel_size elements when prepare ran, the rest use the generic reader
+    size_t kernel_channels = 0;
+
+public:
+    // prepare
+    //  Pick the kernel for the set size most channels share, see reader_eviction_count::prepare.
+    void prepare(State& state, chain_t& chain){
+        kernel_size = 0;
+        kernel_channels = 0;
+
+        // counts[size] is the number of channels of that size, for sizes with a kernel
+        std::vector<size_t> counts;
+        for(channel_t channel = 0; channel < state.sets.size(); channel += 1){
+            size_t size = state.sets[channel].size();
+            dispatch(size, [&](auto){
+                counts.resize(std::max(counts.size(), size + 1));
+                counts[size] += 1;
+            });
+        }
+
+        for(size_t size = 0; size < counts.size(); size += 1){
+            if(counts[size] > kernel_channels){
+                kernel_size = size;
+                kernel_channels = counts[size];
+            }
+        }
+
+        if(kernel_channels < state.sets.size()){
+            std::cerr << (state.sets.size() - kernel_channels) << " of " << state.sets.size()
+                      << " channels use the generic reader, not the unrolled kernel" << std::endl;
+        }
+
+        if(timing == timing_mode::aggregate){
+            aggregate_t::prepare(state, chain);
+        }
+    }
+
+    // See reader_eviction_count::read_channel
+    std::vector<sample_t> read_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain
+    ){
+        std::vector<sample_t> samples;
+        samples.reserve(this->sample_count);
+
+        record_channel(state, channel, chain, [&](sample_t sample){
+            samples.push_back(sample);
+        });
+
+        return samples;
+    }
+
+    // See reader_eviction_count::read_channels
+    std::vector<std::vector<sample_t>> read_channels(
+        State& state,
+        std::vector<channel_t>& channels,
+        chain_t& chain
+    ){
+        std::vector<std::vector<sample_t>> samples;
+        for(auto channel: channels){
+            samples.push_back(read_channel(state, channel, chain));
+        }
+        return samples;
+    }
+
+    // See reader_eviction_count::record_channel
+    template<class Sink>
+    void record_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        Sink&& sink
+    ){
+        size_t count = this->sample_count;
+        record(state, channel, chain, sink, [count](size_t i){ return i < count; });
+    }
+
+    // See reader_eviction_count::stream_channel
+    template<class Sink>
+    void stream_channel(
+        State& state,
+        channel_t channel,
+        chain_t& chain,
+        std::atomic<bool> const& stop,
+        Sink&& sink
+    ){
+        record(state, channel, chain, sink, [&stop](size_t){
+            return !stop.load(std::memory_order_relaxed);
+        });
+    }
+
+protected:
+    // dispatch
+    //  Call fn with std::integral_constant<size_t, size> if size is in KERNEL_SIZES. Returns false
+    //  if there is no kernel for size.
+    template<class Fn>
+    static bool dispatch(size_t size, Fn&& fn){
+        return dispatch(size, fn, KERNEL_SIZES());
+    }
+
+    template<class Fn, size_t... Sizes>
+    static bool dispatch(size_t size, Fn& fn, std::index_sequence<Sizes...>){
+        return ((size == Sizes && (fn(std::integral_constant<size_t, Sizes>()), true)) || ...);
+    }
+
+    // record
+    //  Record samples while more(i) is true for the i-th sample, with the kernel picked by prepare
+    //  if it fits the channel's set.
+    template<class Sink, class More>
+    void record(State& state, channel_t channel, chain_t& chain, Sink& sink, More more){
+        auto&& set = state.sets[channel];
+
+        // The kernels do not track latencies, adaptive thresholds use the generic reader
+        bool fits = (set.size() == kernel_size) && !this->adaptive;
+
+        bool unrolled = fits && dispatch(kernel_size, [&](auto size){
+            static const size_t SIZE = decltype(size)::value;
+
+            if(timing == timing_mode::aggregate){
+                record_fixed<SIZE, timing_mode::aggregate>(state, channel, chain, sink, more);
+            } else {
+                record_fixed<SIZE, timing_mode::element>(state, channel, chain, sink, more);
+            }
+        });
+
+        if(unrolled){
+            return;
+        }
+
+        if(timing == timing_mode::aggregate){
+            aggregate_t::record_while(state, channel, chain, sink, more);
+        } else {
+            record_generic(state, channel, chain, sink, more);
+        }
+    }
+
+    template<size_t Size, timing_mode Mode, class Sink, class More>
+    void record_fixed(State& state, channel_t channel, chain_t& chain, Sink& sink, More more){
+        std::array<element_t, Size> set;
+        std::copy_n(state.sets[channel].begin(), Size, set.begin());
+
+        if constexpr(Mode == timing_mode::aggregate){
+            this->begin_channel(state, channel, chain);
+        } else {
+            this->begin(channel);
+        }
+
+        // Alternate the direction for the same reason reader_eviction_count alternates the order
+        auto slot_start = state.timer->get_ticks(chain);
+        for(size_t i = 0; more(i); i += 1){
+            sink((i % 2 == 0) ?
+                probe_fixed<Size, true, Mode>(state, set, slot_start, chain) :
+                probe_fixed<Size, false, Mode>(state, set, slot_start, chain)
+            );
+            slot_start += this->sample_length;
+        }
+    }
+
+    template<class Sink, class More>
+    void record_generic(State& state, channel_t channel, chain_t& chain, Sink& sink, More more){
+        auto&& set = state.sets[channel];
+        this->begin(channel);
+
+        auto slot_start = state.timer->get_ticks(chain);
+        for(size_t i = 0; more(i); i += 1){
+            sink((i % 2 == 0) ?
+                base_t::probe(state, set.begin(), set.end(), slot_start, chain) :
+                base_t::probe(state, set.rbegin(), set.rend(), slot_start, chain)
+            );
+            slot_start += this->sample_length;
         }
-        return samples;
     }
 
-protected:
-    // probe
-    //  Return the number of elements in the provided range that have been evicted then busy wait
-    //  until the end of the timeslot.
-    //
-    //  Returns MISSED_TIME_SLOT if probe is called and the timeslot has already been missed or if
-    //  element accessing took longer than the timeslot.
-    template<class Iterator>
-    inline sample_t probe(
+    // probe_fixed<Size, Forward, Mode>
+    //  See reader_eviction_count::probe and reader_aggregate::probe.
+    template<size_t Size, bool Forward, timing_mode Mode>
+    inline sample_t probe_fixed(
         State& state,
-        Iterator begin,
-        Iterator end,
+        std::array<element_t, Size> const& set,
         ticks_t slot_start,
         chain_t& chain
     ){
-        sample_t count = 0;
-        auto time_start = state.timer->get_ticks(chain);
-        auto time_end = time_start;
+        using kernel_t = probe_kernel<Size, Forward, Mode>;
 
-        // Check if previous timeslot overran and consumed out timeslot
-        if((time_end - slot_start) > sample_length){
+        auto time_end = state.timer->get_ticks(chain);
+
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
             return MISSED_TIME_SLOT;
         }
 
-        for(auto it = begin; it != end; ++it){
-            state.backend->access_element(*it, chain);
-            time_end = state.timer->get_ticks(chain);
+        // An access latency without timer_overhead reaches threshold exactly when the measured
+        // latency reaches threshold + timer_overhead
+        auto result = kernel_t::run(
+            *state.backend, *state.timer, set, this->threshold + this->timer_overhead, time_end,
+            chain
+        );
+
+        sample_t count;
+        if constexpr(Mode == timing_mode::aggregate){
+            count = this->estimate(result);
+        } else {
+            count = (sample_t)result;
+        }
 
-            // Check if element was evicted
-            if((time_end - time_start) >= threshold){
-                count += 1;
+        auto& strategy = this->strategy;
+        if(strategy.repetitions > 0){
+            if(is_plain(strategy)){
+                for(size_t i = 0; i < strategy.repetitions; i += 1){
+                    prime_kernel<Size>::run(*state.backend, set, chain);
+                }
+            } else {
+                access_pattern(*state.backend, set.begin(), set.end(), strategy, chain);
             }
-
-            time_start = time_end;
+            time_end = state.timer->get_ticks(chain);
         }
 
-        // We might have missed our timeslot if our code was interrupted
-        if((time_end - slot_start) > sample_length){
+        if((time_end - slot_start) > this->sample_length){
+            this->miss(state, slot_start, time_end, chain);
             return MISSED_TIME_SLOT;
         }
 
-        // Spin until the end of our time slot
-        while((time_end - slot_start) < sample_length){
+        this->pace(time_end - slot_start, false);
+
+        while((time_end - slot_start) < this->sample_length){
             time_end = state.timer->get_ticks(chain);
         }
 
         return count;
     }
+
+    // is_plain
+    //  True if strategy accesses the set in order, once per repetition.
+    static bool is_plain(eviction_strategy const& strategy){
+        return strategy.count == 1 && strategy.distance == 1 && strategy.step == 1 &&
+            strategy.order == access_order::forward && !strategy.write;
+    }
+};
+
+// element_line
+//  The cache line of element within its page, 0 to LINES_PER_PAGE - 1. Works for the pointers of
+//  cache and hugepage_cache and the simulated addresses of simulator::cache.
+static const size_t PAGE_BYTES = 4096;
+static const size_t LINE_BYTES = 64;
+static const size_t LINES_PER_PAGE = PAGE_BYTES / LINE_BYTES;
+
+template<class Element>
+inline size_t element_line(Element element){
+    uintptr_t address;
+    if constexpr(std::is_pointer<Element>::value){
+        address = reinterpret_cast<uintptr_t>(element);
+    } else {
+        address = (uintptr_t)element;
+    }
+    return (address % PAGE_BYTES) / LINE_BYTES;
+}
+
+// set_iterator<Element>
+//  Random access iterator over the offsets of a set_view, dereferences to the element.
+template<class Element>
+struct set_iterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Element;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Element;
+
+private:
+    int32_t const* offset;
+    Element base;
+
+public:
+    set_iterator(int32_t const* offset = nullptr, Element base = {}) : offset(offset), base(base){
+    }
+
+    inline Element operator*() const {
+        return base + (difference_type)*offset;
+    }
+
+    inline Element operator[](difference_type index) const {
+        return base + (difference_type)offset[index];
+    }
+
+    inline set_iterator& operator++(){ offset += 1; return *this; }
+    inline set_iterator& operator--(){ offset -= 1; return *this; }
+    inline set_iterator operator++(int){ auto old = *this; offset += 1; return old; }
+    inline set_iterator operator--(int){ auto old = *this; offset -= 1; return old; }
+
+    inline set_iterator& operator+=(difference_type n){ offset += n; return *this; }
+    inline set_iterator& operator-=(difference_type n){ offset -= n; return *this; }
+    inline set_iterator operator+(difference_type n) const { return {offset + n, base}; }
+    inline set_iterator operator-(difference_type n) const { return {offset - n, base}; }
+
+    inline difference_type operator-(set_iterator const& other) const {
+        return offset - other.offset;
+    }
+
+    inline bool operator==(set_iterator const& other) const { return offset == other.offset; }
+    inline bool operator!=(set_iterator const& other) const { return offset != other.offset; }
+    inline bool operator<(set_iterator const& other) const { return offset < other.offset; }
+    inline bool operator>(set_iterator const& other) const { return offset > other.offset; }
+    inline bool operator<=(set_iterator const& other) const { return offset <= other.offset; }
+    inline bool operator>=(set_iterator const& other) const { return offset >= other.offset; }
+
+    friend inline set_iterator operator+(difference_type n, set_iterator const& it){
+        return it + n;
+    }
+};
+
+// set_view<Element>
+//  A set stored in a set_arena. Behaves like a read only std::vector<Element>, elements are
+//  returned by value.
+template<class Element>
+struct set_view {
+public:
+    using iterator = set_iterator<Element>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+private:
+    int32_t const* offsets;
+    size_t count;
+    Element base;
+
+public:
+    set_view(int32_t const* offsets, size_t count, Element base) :
+        offsets(offsets), count(count), base(base)
+    {
+    }
+
+    inline iterator begin() const { return {offsets, base}; }
+    inline iterator end() const { return {offsets + count, base}; }
+    inline reverse_iterator rbegin() const { return reverse_iterator(end()); }
+    inline reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+    inline size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+
+    inline Element operator[](size_t index) const { return begin()[index]; }
+    inline Element front() const { return (*this)[0]; }
+    inline Element back() const { return (*this)[count - 1]; }
+
+    // data
+    //  The offsets of the elements from set_arena's first element.
+    inline int32_t const* data() const { return offsets; }
+
+    std::vector<Element> to_vector() const {
+        return std::vector<Element>(begin(), end());
+    }
+};
+
+// set_arena<Element>
+//  The eviction sets of a state in a single page aligned block, rather than a std::vector per set.
+//  Elements are stored as 32 bit offsets from the first element added, so every element must lie
+//  within 2^31 elements of it (true for the elements of one backend buffer). A set costs 4 bytes
+//  per element rounded up to a cache line, instead of 8 bytes per element plus a separate heap
+//  block, and probing a set reads its offsets from consecutive lines of the arena.
+//
+//  Each set starts on a new cache line, and its lines are placed so that none of them shares its
+//  line within the page (see element_line) with the set's first element. The offsets of a set are
+//  then never in the cache set that is being probed through them. extend_elements produces sets
+//  in line order, so the arena starts half a page in and sets of up to SET_LINE_CAPACITY elements
+//  built that way are placed back to back without skipping lines.
+//
+//  sets[channel] returns a set_view. Views are invalidated by adding sets.
+template<class Element>
+struct set_arena {
+public:
+    using view_t = set_view<Element>;
+
+    // Offsets per cache line
+    static const size_t SET_LINE_CAPACITY = LINE_BYTES / sizeof(int32_t);
+
+private:
+    struct alignas(PAGE_BYTES) page {
+        int32_t offsets[PAGE_BYTES / sizeof(int32_t)];
+    };
+
+    struct range {
+        uint32_t start;
+        uint32_t size;
+    };
+
+    std::vector<page> pages;
+    std::vector<range> ranges;
+
+    // The first element of the first non-empty set, offsets are relative to it
+    Element base = {};
+    bool has_base = false;
+
+    // Next free line, counted from the start of the first page
+    size_t cursor = LINES_PER_PAGE / 2;
+
+public:
+    set_arena() = default;
+
+    set_arena(std::vector<std::vector<Element>> const& sets){
+        assign(sets);
+    }
+
+    set_arena& operator=(std::vector<std::vector<Element>> const& sets){
+        assign(sets);
+        return *this;
+    }
+
+    void assign(std::vector<std::vector<Element>> const& sets){
+        clear();
+        for(auto& set : sets){
+            push_back(set);
+        }
+    }
+
+    void clear(){
+        pages.clear();
+        ranges.clear();
+        base = {};
+        has_base = false;
+        cursor = LINES_PER_PAGE / 2;
+    }
+
+    template<class Set>
+    void push_back(Set const& set){
+        size_t size = set.size();
+        if(!has_base && size > 0){
+            base = set[0];
+            has_base = true;
+        }
+
+        size_t lines = std::max((size + SET_LINE_CAPACITY - 1) / SET_LINE_CAPACITY, (size_t)1);
+        size_t avoid = (size > 0) ? element_line(set[0]) : LINES_PER_PAGE;
+
+        while(overlaps(cursor, lines, avoid)){
+            cursor += 1;
+        }
+
+        size_t needed = (cursor + lines + LINES_PER_PAGE - 1) / LINES_PER_PAGE;
+        if(pages.size() < needed){
+            pages.resize(needed);
+        }
+
+        size_t start = cursor * SET_LINE_CAPACITY;
+        int32_t* offsets = data() + start;
+        for(size_t i = 0; i < size; i += 1){
+            auto offset = (int64_t)(set[i] - base);
+            if(offset < INT32_MIN || offset > INT32_MAX){
+                std::cerr << "Element is too far from the first element of set_arena" << std::endl;
+                std::abort();
+            }
+            offsets[i] = (int32_t)offset;
+        }
+
+        ranges.push_back({(uint32_t)start, (uint32_t)size});
+        cursor += lines;
+    }
+
+    inline view_t operator[](channel_t channel) const {
+        auto& r = ranges[channel];
+        return view_t(data() + r.start, r.size, base);
+    }
+
+    inline size_t size() const {
+        return ranges.size();
+    }
+
+    inline bool empty() const {
+        return ranges.empty();
+    }
+
+    // get_memory_usage
+    //  Bytes used by the arena and the per set ranges.
+    size_t get_memory_usage() const {
+        return pages.capacity() * sizeof(page) + ranges.capacity() * sizeof(range);
+    }
+
+private:
+    inline int32_t* data(){
+        return pages.empty() ? nullptr : pages.data()->offsets;
+    }
+
+    inline int32_t const* data() const {
+        return pages.empty() ? nullptr : pages.data()->offsets;
+    }
+
+    static bool overlaps(size_t first, size_t lines, size_t line){
+        for(size_t i = first; i < first + lines; i += 1){
+            if(i % LINES_PER_PAGE == line){
+                return true;
+            }
+        }
+        return false;
+    }
 };
 
 // TODO: Clean this all up
@@ -330,19 +2773,283 @@ struct state {
     std::unique_ptr<Backend> backend;
     std::unique_ptr<Timer> timer;
     std::unique_ptr<Evicter> evicter;
-    std::vector<typename Backend::set_t> sets;
+    set_arena<typename Backend::element_t> sets;
+};
+
+// streaming_state
+//  Like state, but eviction sets are constructed on a background thread and published to sets as
+//  soon as each one is extended. Readers only ever index sets below wait_for_channel's limit.
+template<class Backend, class Timer, class Evicter>
+struct streaming_state {
+    using backend_t = Backend;
+    using timer_t = Timer;
+
+    std::unique_ptr<Backend> backend;
+    std::unique_ptr<Timer> timer;
+    std::unique_ptr<Evicter> evicter;
+    utils::append_only_vector<typename Backend::set_t> sets;
+
+    std::thread builder;
+    std::atomic<bool> cancel{false};
+
+private:
+    std::mutex mutex;
+    std::condition_variable published;
+    bool complete = false;
+    bool tuned = false;
+
+public:
+    ~streaming_state(){
+        cancel.store(true);
+        if(builder.joinable()){
+            builder.join();
+        }
+    }
+
+    // publish
+    //  Make a set available to readers, may be called from multiple builder threads.
+    void publish(typename Backend::set_t const& set){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sets.push_back(set);
+        }
+        published.notify_all();
+    }
+
+    // finish
+    //  Called once construction has finished, no more sets will be published.
+    void finish(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            complete = true;
+            tuned = true;
+        }
+        published.notify_all();
+    }
+
+    // finish_tuning
+    //  Called once evicter's probe_strategy will no longer change, see create_streaming.
+    void finish_tuning(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tuned = true;
+        }
+        published.notify_all();
+    }
+
+    // wait_for_tuning
+    //  Block until finish_tuning or finish has been called.
+    void wait_for_tuning(){
+        std::unique_lock<std::mutex> lock(mutex);
+        published.wait(lock, [&]{ return tuned; });
+    }
+
+    // wait_for_channel
+    //  Block until channel has been published or construction has finished. Returns false if the
+    //  channel will never be published.
+    bool wait_for_channel(channel_t channel){
+        if(channel < sets.size()){
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        published.wait(lock, [&]{ return complete || channel < sets.size(); });
+        return channel < sets.size();
+    }
 };
 
+template<
+    class Backend,
+    class Timer,
+    class Evicter,
+    template<class> class Reader = reader_eviction_count
+>
+using source_group_t = signal::source_group<
+    state<Backend, Timer, Evicter>,
+    Reader<state<Backend, Timer, Evicter>>
+>;
+
+template<
+    template<class> class Reader = reader_eviction_count,
+    class Backend,
+    class Timer,
+    class Evicter
+>
+source_group_t<Backend, Timer, Evicter, Reader> create_source_group(
+    std::shared_ptr<state<Backend, Timer, Evicter>> s
+){
+    using state_t = state<Backend, Timer, Evicter>;
+
+    Reader<state_t> r;
+    r.threshold = s->evicter->threshold;
+    r.strategy = s->evicter->probe_strategy;
+
+    chain_t chain;
+    r.prepare(*s, chain);
+
+    return source_group_t<Backend, Timer, Evicter, Reader>(s, r);
+}
+
+// create
+//  Construct eviction sets on Backend and return a source group reading them with Reader. For
+//  example create<cache, timer::rdtscp32, linked_evicter<...>, reader_linked_list>() uses the
+//  pointer chasing kernels for both construction and probing.
 template<
     class Backend = cache,
     class Timer = timer::rdtscp32,
-    class Evicter = evicter<Backend, Timer>
+    class Evicter = evicter<Backend, Timer>,
+    template<class> class Reader = reader_eviction_count
 >
-signal::source_group<
-    state<Backend, Timer, Evicter>,
-    reader_eviction_count<state<Backend, Timer, Evicter>>
-> create(){
+source_group_t<Backend, Timer, Evicter, Reader> create(eviction_set_options const& options = {}){
+    using state_t = state<Backend, Timer, Evicter>;
+
+    auto s = std::make_shared<state_t>();
+    chain_t chain;
+
+    s->backend = std::make_unique<Backend>();
+    s->timer = std::make_unique<Timer>();
+
+    s->evicter = std::make_unique<Evicter>(
+        s->backend.get(),
+        s->timer.get(),
+        chain
+    );
+
+    using builder_t = eviction_set_builder<Evicter>;
+
+    auto candidates = s->backend->get_elements();
+    auto base = builder_t::build_base(*s->evicter, candidates, options);
+
+    if(options.autotune){
+        s->evicter->autotune_probe(base, chain);
+    }
+
+    s->sets = builder_t::extend(*s->evicter, base);
+
+    return create_source_group<Reader>(s);
+}
+
+// create_for
+//  Same as create(options), but only constructs the eviction sets able to evict target, see
+//  eviction_set_builder::build_for_element. Useful when the victim's address is already known.
+template<
+    class Backend = cache,
+    class Timer = timer::rdtscp32,
+    class Evicter = evicter<Backend, Timer>,
+    template<class> class Reader = reader_eviction_count
+>
+source_group_t<Backend, Timer, Evicter, Reader> create_for(
+    typename Backend::element_t target,
+    eviction_set_options const& options = {}
+){
+    using state_t = state<Backend, Timer, Evicter>;
+
+    auto s = std::make_shared<state_t>();
+    chain_t chain;
+
+    s->backend = std::make_unique<Backend>();
+    s->timer = std::make_unique<Timer>();
+
+    s->evicter = std::make_unique<Evicter>(
+        s->backend.get(),
+        s->timer.get(),
+        chain
+    );
+
+    s->sets = eviction_set_builder<Evicter>::build_for_element(*s->evicter, target, options);
+
+    return create_source_group<Reader>(s);
+}
+
+// create
+//  Same as create(options), but reuses the calibration and eviction sets from the profile stored
+//  at profile_path if it was created on this host. Stored eviction sets are spot checked against
+//  their witness and only the ones that fail are rebuilt. The profile is rewritten whenever
+//  anything had to be calibrated or rebuilt. The probe strategy is not stored, with
+//  options.autotune it is tuned on the stored sets every time.
+template<
+    class Backend = cache,
+    class Timer = timer::rdtscp32,
+    class Evicter = evicter<Backend, Timer>,
+    template<class> class Reader = reader_eviction_count
+>
+source_group_t<Backend, Timer, Evicter, Reader> create(
+    std::string const& profile_path,
+    eviction_set_options const& options = {}
+){
     using state_t = state<Backend, Timer, Evicter>;
+    using builder_t = eviction_set_builder<Evicter>;
+    using calibration_t = timer::realtime_calibration<Timer>;
+
+    auto s = std::make_shared<state_t>();
+    chain_t chain;
+
+    s->backend = std::make_unique<Backend>();
+    s->timer = std::make_unique<Timer>();
+
+    profile<Backend, Timer> saved;
+    bool loaded = saved.load(profile_path, *s->backend);
+    size_t failed = 0;
+
+    if(loaded){
+        calibration_t::settings = saved.realtime;
+        calibration_t::calibrated = true;
+
+        s->evicter = std::make_unique<Evicter>(
+            s->backend.get(),
+            s->timer.get(),
+            saved.threshold
+        );
+
+        failed = builder_t::verify(*s->evicter, saved.sets, chain);
+        std::cerr << saved.sets.size() << " sets loaded, " << failed << " failed" << std::endl;
+    } else {
+        s->evicter = std::make_unique<Evicter>(
+            s->backend.get(),
+            s->timer.get(),
+            chain
+        );
+    }
+
+    if(!loaded || failed > 0){
+        builder_t::build_missing(*s->evicter, saved.sets, options);
+
+        saved.threshold = s->evicter->threshold;
+        saved.realtime = calibration_t::calibrate();
+        saved.save(profile_path, *s->backend);
+    }
+
+    if(options.autotune){
+        s->evicter->autotune_probe(saved.sets, chain);
+    }
+
+    s->sets = builder_t::extend(*s->evicter, saved.sets);
+
+    return create_source_group<Reader>(s);
+}
+
+// create_streaming
+//  Same as create(options), but returns immediately after calibration. Eviction sets are
+//  constructed on a background thread and each channel becomes readable as soon as its set has
+//  been built, so scanning (e.g. signal::find_first) can start on the first channels while the
+//  rest of the cache is still being constructed.
+//
+//  With options.autotune the probe strategy is tuned on the first TUNING_SETS base sets, and this
+//  only returns once that is done. Construction primes the LLC with every set it tests, so until
+//  wait_for_channels returns, channels read on other cores see evictions from the builder thread
+//  as well as from the victim. Wait for construction to finish before recording anything that is
+//  sensitive to that noise.
+template<
+    class Backend = cache,
+    class Timer = timer::rdtscp32,
+    class Evicter = evicter<Backend, Timer>
+>
+signal::streaming_source_group<
+    streaming_state<Backend, Timer, Evicter>,
+    reader_eviction_count<streaming_state<Backend, Timer, Evicter>>
+> create_streaming(eviction_set_options options = {}){
+    using state_t = streaming_state<Backend, Timer, Evicter>;
+    using builder_t = eviction_set_builder<Evicter>;
 
     auto s = std::make_shared<state_t>();
     chain_t chain;
@@ -356,14 +3063,55 @@ signal::source_group<
         chain
     );
 
-    s->sets = eviction_set_builder<Evicter>::build(*s->evicter);
+    options.cancel = &s->cancel;
+
+    // The builder thread must not keep the state alive, the state's destructor joins it
+    auto state = s.get();
+    s->builder = std::thread([state, options]{
+        std::vector<typename Backend::element_t> candidates = state->backend->get_elements();
+        std::vector<typename builder_t::witnessed_set_t> tuning;
+        chain_t chain;
+
+        auto tune = [&]{
+            if(!tuning.empty()){
+                state->evicter->autotune_probe(tuning, chain);
+            }
+            state->finish_tuning();
+        };
+
+        if(!options.autotune){
+            state->finish_tuning();
+        }
+
+        builder_t::build_base(*state->evicter, candidates, options, [&](auto const& set){
+            // Tuning in between attempts keeps it from racing with construction
+            if(options.autotune && tuning.size() < Evicter::TUNING_SETS){
+                tuning.push_back(set);
+                if(tuning.size() == Evicter::TUNING_SETS){
+                    tune();
+                }
+            }
+
+            for(auto& extended : state->backend->extend_elements(set.elements)){
+                state->publish(extended);
+            }
+        });
+
+        // Fewer than TUNING_SETS sets were built, tune on those
+        if(options.autotune && tuning.size() < Evicter::TUNING_SETS){
+            tune();
+        }
+
+        state->finish();
+    });
+
+    s->wait_for_tuning();
 
     reader_eviction_count<state_t> r;
     r.threshold = s->evicter->threshold;
+    r.strategy = s->evicter->probe_strategy;
 
-    signal::source_group<state_t, reader_eviction_count<state_t>> g(s, r);
-
-    return g;
+    return signal::streaming_source_group<state_t, reader_eviction_count<state_t>>(s, r);
 }
 
 } // namespace prime_probe
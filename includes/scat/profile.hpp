@@ -0,0 +1,221 @@
+#ifndef SCAT_HEADER_PROFILE
+#define SCAT_HEADER_PROFILE
+
+#include <scat/set_construction.hpp>
+#include <scat/timer.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include <unistd.h>
+
+namespace scat {
+namespace prime_probe {
+
+// get_cpu_model
+//  Returns a string identifying the processor, the brand string and cpuid signature on x86.
+inline std::string get_cpu_model(){
+    std::ostringstream model;
+
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int brand[12] = {0};
+    if(__get_cpuid_max(0x80000000, nullptr) >= 0x80000004){
+        for(unsigned int leaf = 0; leaf < 3; leaf += 1){
+            auto registers = &brand[leaf * 4];
+            __get_cpuid(
+                0x80000002 + leaf,
+                &registers[0], &registers[1], &registers[2], &registers[3]
+            );
+        }
+    }
+
+    char name[sizeof(brand) + 1] = {0};
+    std::memcpy(name, brand, sizeof(brand));
+
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+
+    model << name << " (" << std::hex << eax << ")";
+#else
+    model << "unknown";
+#endif
+
+    return model.str();
+}
+
+// get_host_key
+//  Returns a string identifying everything a profile depends on. The processor, the geometry of the
+//  last level cache, the geometry of the backend and the type of pages backing the backend.
+template<class Backend>
+std::string get_host_key(Backend& backend){
+    std::ostringstream key;
+
+    key << "cpu=" << get_cpu_model() << ";";
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    key << "llc=" << sysconf(_SC_LEVEL3_CACHE_SIZE)
+        << "/" << sysconf(_SC_LEVEL3_CACHE_ASSOC)
+        << "/" << sysconf(_SC_LEVEL3_CACHE_LINESIZE) << ";";
+#endif
+
+    key << "buffer=" << backend.get_buffer_size() << ";";
+    key << "ways=" << Backend::EVICTION_SET_SIZE << ";";
+    key << "pages=" << backend.get_page_type();
+
+    return key.str();
+}
+
+// profile
+//  The results of calibration and eviction set construction, stored on disk so that they can be
+//  reused the next time the program starts.
+//
+//  Eviction sets are stored as offsets into the backend's buffer. Whether they are still valid
+//  depends on the buffer mapping to the same physical memory as when they were built, so they must
+//  be checked against their witness after loading (see eviction_set_builder::verify). The
+//  calibration only depends on the host, which is identified by get_host_key.
+template<class Backend, class Timer>
+struct profile {
+public:
+    using element_t = typename Backend::element_t;
+    using ticks_t = typename Timer::ticks_t;
+    using settings_t = typename timer::realtime_calibration<Timer>::settings_t;
+
+    static const unsigned int VERSION = 1;
+
+public:
+    ticks_t threshold = 0;
+    settings_t realtime = {};
+    std::vector<witnessed_set<element_t>> sets;
+
+public:
+    // load
+    //  Load the profile stored at path. Returns false if there is no profile, if it can not be read
+    //  or if it was created on a different host, in which case the profile is left empty.
+    bool load(std::string const& path, Backend& backend){
+        std::ifstream file(path);
+        if(!file){
+            return false;
+        }
+
+        std::string magic;
+        unsigned int version = 0;
+        file >> magic >> version;
+
+        if(magic != "scat-profile" || version != VERSION){
+            std::cerr << "Ignoring profile " << path << ", unsupported format" << std::endl;
+            return false;
+        }
+
+        std::string field, key;
+        file >> field >> std::ws;
+        std::getline(file, key);
+
+        if(field != "key" || key != get_host_key(backend)){
+            std::cerr << "Ignoring profile " << path << ", created on another host" << std::endl;
+            return false;
+        }
+
+        int64_t realtime_count = 0;
+        std::string realtime_field;
+        file >> field >> threshold;
+        file >> realtime_field >> realtime.ratio >> realtime_count >> realtime.ticks;
+        realtime.realtime = std::chrono::nanoseconds(realtime_count);
+
+        if(!file || field != "threshold" || realtime_field != "realtime"){
+            std::cerr << "Ignoring profile " << path << ", could not be read" << std::endl;
+            return false;
+        }
+
+        sets.clear();
+        while(file >> field && field == "set"){
+            size_t witness, count;
+            file >> witness >> count;
+
+            witnessed_set<element_t> set;
+            // offset_to_element returns a value initialized element for offsets outside the buffer
+            set.witness = backend.offset_to_element(witness);
+            bool valid = (set.witness != element_t{});
+
+            for(size_t i = 0; i < count; i += 1){
+                size_t offset;
+                file >> offset;
+
+                auto element = backend.offset_to_element(offset);
+                valid = valid && (element != element_t{});
+                set.elements.push_back(element);
+            }
+
+            if(valid){
+                sets.push_back(set);
+            }
+        }
+
+        if(file.bad() || (!file.eof() && file.fail())){
+            std::cerr << "Ignoring profile " << path << ", could not be read" << std::endl;
+            sets.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    // save
+    //  Write the profile to path, replacing any existing profile. The profile is written to a
+    //  temporary file next to path and renamed over it once complete, so a failed save leaves the
+    //  previous profile intact. Returns false on failure.
+    bool save(std::string const& path, Backend& backend){
+        std::string temporary = path + ".tmp";
+
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+
+            file << "scat-profile " << VERSION << "\n";
+            file << "key " << get_host_key(backend) << "\n";
+            file << "threshold " << threshold << "\n";
+            file << "realtime " << std::setprecision(9) << realtime.ratio
+                 << " " << realtime.realtime.count()
+                 << " " << realtime.ticks << "\n";
+
+            for(auto& set : sets){
+                file << "set " << backend.element_to_offset(set.witness) << " "
+                     << set.elements.size();
+                for(auto element : set.elements){
+                    file << " " << backend.element_to_offset(element);
+                }
+                file << "\n";
+            }
+
+            // Write errors only show up once the buffered output has been flushed
+            file.close();
+            if(!file){
+                std::cerr << "Could not save profile " << path << std::endl;
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+
+        if(std::rename(temporary.c_str(), path.c_str()) != 0){
+            std::cerr << "Could not save profile " << path << std::endl;
+            std::remove(temporary.c_str());
+            return false;
+        }
+
+        return true;
+    }
+};
+
+} // namespace prime_probe
+} // namespace scat
+
+#endif // SCAT_HEADER_PROFILE
@@ -2,13 +2,247 @@
 #define SCAT_HEADER_SET_CONSTRUCTION
 
 #include <scat/chain.hpp>
+#include <scat/utils.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
 #include <random>
+#include <thread>
 #include <vector>
 
 namespace scat {
 
+// contract_strategy
+//  Selects how eviction_set_builder removes elements that do not contribute to an eviction.
+enum class contract_strategy {
+    // Remove a single element per call to set_evicts. O(n) calls, each priming the whole set.
+    linear,
+
+    // Split the set into 2 * EVICTION_SET_SIZE groups and try removing each of them in turn. Every
+    // pass costs 2w calls and halves the set, O(w log n) calls in total.
+    group_testing,
+};
+
+// expand_strategy
+//  Selects how eviction_set_builder grows a set of candidates until it evicts the witness.
+enum class expand_strategy {
+    // Add a single candidate per call to set_evicts.
+    linear,
+
+    // Double the set until it evicts the witness, then binary search for the smallest prefix of the
+    // set that still evicts the witness. O(log n) calls to set_evicts.
+    doubling,
+};
+
+// build_statistics
+//  Counters and timings collected by eviction_set_builder while constructing eviction sets, see
+//  eviction_set_options::statistics. Safe to update from every worker of build_parallel.
+struct build_statistics {
+public:
+    using clock_t = std::chrono::steady_clock;
+
+    struct phase_statistics {
+        // Calls to set_evicts and set_evicts_batch made during the phase
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> batch_calls{0};
+
+        // Wall time spent in the phase, summed over every worker
+        std::atomic<uint64_t> nanoseconds{0};
+    };
+
+    phase_statistics expand;
+    phase_statistics contract;
+    phase_statistics collect;
+
+    // Outcome of every attempt, an attempt either succeeds or fails in exactly one way
+    std::atomic<uint64_t> attempts{0};
+    std::atomic<uint64_t> successes{0};
+    std::atomic<uint64_t> expand_failures{0};
+    std::atomic<uint64_t> contract_failures{0};
+    std::atomic<uint64_t> duplicates{0};
+
+    // Construction time is measured from here
+    clock_t::time_point start = clock_t::now();
+
+private:
+    std::mutex mutex;
+
+    // Seconds since start at which each eviction set was constructed, in order
+    std::vector<double> set_times;
+
+    // Number of eviction sets constructed of each size
+    std::map<size_t, size_t> set_sizes;
+
+public:
+    // add_set
+    //  Record that an eviction set of size elements was constructed.
+    void add_set(size_t size){
+        std::chrono::duration<double> elapsed = clock_t::now() - start;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        set_times.push_back(elapsed.count());
+        set_sizes[size] += 1;
+    }
+
+    // get_time_to_sets
+    //  Returns the number of seconds it took to construct count eviction sets, or a negative value
+    //  if fewer were constructed.
+    double get_time_to_sets(size_t count){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(count == 0 || count > set_times.size()){
+            return -1;
+        }
+        return set_times[count - 1];
+    }
+
+    size_t get_set_count(){
+        std::lock_guard<std::mutex> lock(mutex);
+        return set_times.size();
+    }
+
+    // write_json
+    //  Write the statistics as a single JSON object.
+    void write_json(std::ostream& out){
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto write_phase = [&](char const* name, phase_statistics const& phase){
+            out << "\"" << name << "\": {"
+                << "\"calls\": " << phase.calls.load() << ", "
+                << "\"batch_calls\": " << phase.batch_calls.load() << ", "
+                << "\"seconds\": " << phase.nanoseconds.load() * 1e-9 << "}";
+        };
+
+        out << "{\"phases\": {";
+        write_phase("expand", expand);
+        out << ", ";
+        write_phase("contract", contract);
+        out << ", ";
+        write_phase("collect", collect);
+        out << "}, ";
+
+        out << "\"attempts\": {"
+            << "\"total\": " << attempts.load() << ", "
+            << "\"successes\": " << successes.load() << ", "
+            << "\"expand_failures\": " << expand_failures.load() << ", "
+            << "\"contract_failures\": " << contract_failures.load() << ", "
+            << "\"duplicates\": " << duplicates.load() << "}, ";
+
+        out << "\"sets\": " << set_times.size() << ", ";
+        out << "\"time_to_first_set\": ";
+        if(set_times.empty()){
+            out << "null";
+        } else {
+            out << set_times.front();
+        }
+
+        out << ", \"set_times\": [";
+        for(size_t i = 0; i < set_times.size(); i += 1){
+            out << (i == 0 ? "" : ", ") << set_times[i];
+        }
+
+        out << "], \"set_sizes\": {";
+        bool first = true;
+        for(auto& size : set_sizes){
+            out << (first ? "" : ", ") << "\"" << size.first << "\": " << size.second;
+            first = false;
+        }
+        out << "}}";
+    }
+};
+
+struct eviction_set_options {
+    expand_strategy expand = expand_strategy::doubling;
+    contract_strategy contract = contract_strategy::group_testing;
+
+    // Number of worker threads used to construct eviction sets, see
+    // eviction_set_builder::build_parallel.
+    size_t thread_count = 1;
+
+    // Construction stops before the next attempt once cancel is set.
+    std::atomic<bool> const* cancel = nullptr;
+
+    // Seed for shuffling candidates, zero picks a random seed. A fixed seed together with a
+    // deterministic backend (see scat::simulator) makes construction reproducible.
+    uint32_t seed = 0;
+
+    // Statistics are collected here when set, see build_statistics.
+    build_statistics* statistics = nullptr;
+
+    // Tune the primitive's eviction strategy on the first few eviction sets and use the tuned
+    // strategy for the rest of construction, see prime_probe::evicter::autotune. Only applies to
+    // single threaded construction.
+    bool autotune = false;
+};
+
+// witnessed_set
+//  An eviction set constructed by eviction_set_builder, along with the witness it was constructed
+//  to evict. The witness can be used to cheaply check that the eviction set still works.
+template<class Element>
+struct witnessed_set {
+    std::vector<Element> elements;
+    Element witness;
+};
+
+// eviction_set_registry
+//  A lock-free, append only list of the eviction sets constructed so far. Shared between the
+//  workers of eviction_set_builder::build_parallel so that they can tell which eviction sets have
+//  already been built by another worker.
+//
+//  Entries are pushed onto the front of the list and are never removed while the registry is alive,
+//  so any entry reachable from get_head remains valid.
+template<class Element>
+struct eviction_set_registry {
+    struct entry {
+        std::vector<Element> set;
+        Element witness;
+        size_t owner;
+        std::atomic<bool> duplicate;
+        entry* next;
+    };
+
+private:
+    std::atomic<entry*> head{nullptr};
+
+public:
+    eviction_set_registry() = default;
+    eviction_set_registry(eviction_set_registry const&) = delete;
+    eviction_set_registry& operator=(eviction_set_registry const&) = delete;
+
+    ~eviction_set_registry(){
+        auto current = head.load();
+        while(current != nullptr){
+            auto next = current->next;
+            delete current;
+            current = next;
+        }
+    }
+
+    // push
+    //  Publish an eviction set, it will be visible to any call to get_head that happens after.
+    entry* push(std::vector<Element> const& set, Element witness, size_t owner){
+        auto e = new entry{set, witness, owner, {false}, head.load(std::memory_order_relaxed)};
+
+        while(!head.compare_exchange_weak(
+            e->next, e,
+            std::memory_order_release,
+            std::memory_order_relaxed
+        )){}
+
+        return e;
+    }
+
+    // get_head
+    //  Returns the most recently published entry, follow entry::next for older entries.
+    entry* get_head(){
+        return head.load(std::memory_order_acquire);
+    }
+};
+
 template<class T>
 struct eviction_set_builder{
 private:
@@ -22,18 +256,225 @@ private:
     static const size_t EVICTION_SET_SIZE_LOWER = EVICTION_SET_SIZE - 1;
     static const size_t EVICTION_SET_SIZE_UPPER = EVICTION_SET_SIZE + 4;
 
+    // An eviction set needs at most EVICTION_SET_SIZE elements to evict the witness, so at most
+    // EVICTION_SET_SIZE of the groups are needed and a pass over GROUP_COUNT groups removes at
+    // least half of them.
+    static const size_t GROUP_COUNT = 2 * EVICTION_SET_SIZE;
+
+    // Number of eviction sets constructed before tuning, see eviction_set_options::autotune
+    static const size_t AUTOTUNE_SETS = 4;
+
+    // Calls to set_evicts and set_evicts_batch made by the calling thread, see phase_scope.
+    static inline thread_local uint64_t evicts_calls = 0;
+    static inline thread_local uint64_t evicts_batch_calls = 0;
+
+    // phase_scope
+    //  Adds the calls to set_evicts and the wall time spent between construction and destruction
+    //  to a phase of build_statistics. Does nothing if statistics is nullptr.
+    struct phase_scope {
+        build_statistics::phase_statistics* phase;
+        uint64_t calls = evicts_calls;
+        uint64_t batch_calls = evicts_batch_calls;
+        build_statistics::clock_t::time_point start = build_statistics::clock_t::now();
+
+        phase_scope(
+            build_statistics* statistics,
+            build_statistics::phase_statistics build_statistics::* member
+        ) : phase(statistics == nullptr ? nullptr : &(statistics->*member)){
+        }
+
+        ~phase_scope(){
+            if(phase == nullptr){
+                return;
+            }
+
+            auto elapsed = build_statistics::clock_t::now() - start;
+            phase->calls += evicts_calls - calls;
+            phase->batch_calls += evicts_batch_calls - batch_calls;
+            phase->nanoseconds +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        }
+    };
+
 public:
     typedef typename T::element_t element_t;
 
-    static std::vector<std::vector<element_t>> build(T& primitive){
-        std::vector<std::vector<element_t>> eviction_sets;
-        element_t witness;
+    typedef witnessed_set<element_t> witnessed_set_t;
+    typedef eviction_set_registry<element_t> registry_t;
 
-        std::random_device rd;
-        std::mt19937 g(rd());
- 
+    // Called with each eviction set as soon as it is constructed. When building in parallel this is
+    // called from each of the worker threads.
+    typedef std::function<void(witnessed_set_t const&)> callback_t;
+
+    static std::vector<std::vector<element_t>> build(
+        T& primitive,
+        eviction_set_options const& options = {}
+    ){
         std::vector<element_t> candidates = primitive.backend->get_elements();
-        
+        return extend(primitive, build_base(primitive, candidates, options));
+    }
+
+    // build_base
+    //  Construct eviction sets from candidates without extending them, see build.
+    static std::vector<witnessed_set_t> build_base(
+        T& primitive,
+        std::vector<element_t>& candidates,
+        eviction_set_options const& options = {},
+        callback_t const& on_set = {}
+    ){
+        return (options.thread_count > 1) ?
+            build_parallel(primitive, candidates, options, on_set) :
+            build_sets(primitive, candidates, options, on_set);
+    }
+
+    // build_missing
+    //  Construct eviction sets for the resources that are not covered by the known eviction sets.
+    //  Candidates that are part of, or congruent with, a known eviction set are removed before
+    //  construction starts so that only the missing eviction sets are built.
+    static void build_missing(
+        T& primitive,
+        std::vector<witnessed_set_t>& known,
+        eviction_set_options const& options = {}
+    ){
+        std::vector<element_t> used;
+        for(auto& set : known){
+            used.insert(used.end(), set.elements.begin(), set.elements.end());
+            used.push_back(set.witness);
+        }
+        std::sort(used.begin(), used.end());
+
+        std::vector<element_t> candidates;
+        for(auto element : primitive.backend->get_elements()){
+            if(!std::binary_search(used.begin(), used.end(), element)){
+                candidates.push_back(element);
+            }
+        }
+
+        chain_t chain;
+        for(auto& set : known){
+            phase_collect(primitive, candidates, set.elements, chain);
+        }
+
+        auto rebuilt = build_base(primitive, candidates, options);
+        known.insert(known.end(), rebuilt.begin(), rebuilt.end());
+    }
+
+    // verify
+    //  Check that each eviction set still evicts its witness, and remove the eviction sets that do
+    //  not. Returns the number of eviction sets removed.
+    static size_t verify(
+        T& primitive,
+        std::vector<witnessed_set_t>& sets,
+        chain_t& chain
+    ){
+        size_t size = sets.size();
+
+        sets.erase(
+            std::remove_if(sets.begin(), sets.end(), [&](witnessed_set_t& set){
+                return !set_evicts(primitive, set.elements, set.witness, chain);
+            }),
+            sets.end()
+        );
+
+        return size - sets.size();
+    }
+
+    // extend
+    //  For some platforms we only need to discover a subset of the total eviction sets. We are
+    //  able to generate the remaining eviction sets from the discovered subset. For a concrete
+    //  example see l3::extend_elements.
+    static std::vector<std::vector<element_t>> extend(
+        T& primitive,
+        std::vector<witnessed_set_t> const& eviction_sets
+    ){
+        std::vector<std::vector<element_t>> all_eviction_sets;
+        for(auto& set : eviction_sets){
+            auto extended = primitive.backend->extend_elements(set.elements);
+            all_eviction_sets.insert(all_eviction_sets.end(), extended.begin(), extended.end());
+        }
+
+        // LE DEBUGGING INFO XDDD
+        std::cerr << all_eviction_sets.size() << " sets constructed" << std::endl;
+        std::cerr << std::endl;
+
+        return all_eviction_sets;
+    }
+
+    // build_parallel
+    //  Split candidates into options.thread_count disjoint partitions and construct eviction sets
+    //  from each partition on its own pinned worker thread.
+    //
+    //  Each partition only contains 1/thread_count of the candidates, so every partition needs
+    //  enough congruent elements to build an eviction set on its own. Backends should be sized
+    //  accordingly, a partition that cannot build a set simply contributes nothing.
+    //
+    //  Workers share an eviction_set_registry. Before each attempt a worker removes every candidate
+    //  covered by a set another worker has published, and a set that turns out to duplicate a
+    //  published set is dropped rather than returned twice.
+    static std::vector<witnessed_set_t> build_parallel(
+        T& primitive,
+        std::vector<element_t> const& candidates,
+        eviction_set_options const& options,
+        callback_t const& on_set = {}
+    ){
+        size_t thread_count = std::max(options.thread_count, (size_t)1);
+
+        auto g = make_generator(options, 0);
+
+        std::vector<element_t> shuffled = candidates;
+        std::shuffle(shuffled.begin(), shuffled.end(), g);
+
+        std::vector<std::vector<element_t>> partitions(thread_count);
+        for(size_t i = 0; i < shuffled.size(); i += 1){
+            partitions[i % thread_count].push_back(shuffled[i]);
+        }
+
+        registry_t registry;
+        std::vector<std::vector<witnessed_set_t>> results(thread_count);
+        std::vector<std::thread> workers;
+
+        for(size_t worker = 0; worker < thread_count; worker += 1){
+            workers.emplace_back([&, worker]{
+                scat::utils::pin_current_thread(worker);
+                results[worker] = build_sets(
+                    primitive, partitions[worker], options, on_set, &registry, worker
+                );
+            });
+        }
+
+        for(auto& thread : workers){
+            thread.join();
+        }
+
+        std::vector<witnessed_set_t> eviction_sets;
+        for(auto& result : results){
+            eviction_sets.insert(eviction_sets.end(), result.begin(), result.end());
+        }
+
+        return eviction_sets;
+    }
+
+    // build_sets
+    //  Construct eviction sets from candidates until ATTEMPT_COUNT attempts fail in a row. Elements
+    //  that end up in an eviction set, or that are congruent with one, are removed from candidates.
+    //
+    //  The registry and worker are only used by build_parallel.
+    static std::vector<witnessed_set_t> build_sets(
+        T& primitive,
+        std::vector<element_t>& candidates,
+        eviction_set_options const& options,
+        callback_t const& on_set = {},
+        registry_t* registry = nullptr,
+        size_t worker = 0
+    ){
+        std::vector<witnessed_set_t> eviction_sets;
+        element_t witness;
+
+        auto g = make_generator(options, worker + 1);
+
+        // Most recent registry entry this worker has collected candidates against
+        typename registry_t::entry* seen = nullptr;
+
         chain_t chain;
 
         for(size_t attempt = 1; attempt <= ATTEMPT_COUNT; ++attempt){
@@ -44,6 +485,18 @@ public:
                 break;
             }
 
+            if(options.cancel != nullptr && options.cancel->load(std::memory_order_relaxed)){
+                break;
+            }
+
+            // Remove any candidates covered by eviction sets that other workers have built
+            if(registry != nullptr){
+                synchronize(primitive, *registry, seen, worker, candidates, chain);
+                if(candidates.size() <= EVICTION_SET_SIZE){
+                    break;
+                }
+            }
+
             // Why shuffle?
             //   Without shuffling we will have to process on average most of the candidates before
             //   we find an eviction set. This is because elements that map to the same set will be
@@ -58,8 +511,20 @@ public:
             //   to outside the loop.
             std::shuffle(candidates.begin(), candidates.end(), g);
 
+            count(options, &build_statistics::attempts);
+
             // -- Expand phase --
-            if(!phase_expand(primitive, candidates, eviction_set, witness, chain)){
+            bool expanded;
+            {
+                phase_scope scope(options.statistics, &build_statistics::expand);
+                expanded = (options.expand == expand_strategy::doubling) ?
+                    phase_expand_doubling(primitive, candidates, eviction_set, witness, chain) :
+                    phase_expand(primitive, candidates, eviction_set, witness, chain);
+            }
+
+            if(!expanded){
+                count(options, &build_statistics::expand_failures);
+
                 candidates.push_back(witness);
                 candidates.insert(candidates.end(), eviction_set.begin(), eviction_set.end());
 
@@ -71,19 +536,15 @@ public:
             // phase when failing. On other platforms we need to perform multiple contract phases to
             // get any reasonable output. If we can reliably detect which strategy we should use, it
             // might be worth switching strategy based on the platform.
-            for(size_t contract_count = 0; contract_count < CONTRACT_COUNT; contract_count += 1){
-                // Early exit, eviction set is already correct size
-                if(eviction_set.size() <= EVICTION_SET_SIZE_UPPER){
-                    break;
-                }
-                phase_contract(primitive, candidates, eviction_set, witness, chain);
+            bool contracted;
+            {
+                phase_scope scope(options.statistics, &build_statistics::contract);
+                contracted = contract(primitive, candidates, eviction_set, witness, options, chain);
             }
 
-            // Check contract is successful
-            if(
-                eviction_set.size() < EVICTION_SET_SIZE_LOWER ||
-                eviction_set.size() > EVICTION_SET_SIZE_UPPER
-            ){
+            if(!contracted){
+                count(options, &build_statistics::contract_failures);
+
                 candidates.push_back(witness);
                 candidates.insert(candidates.end(), eviction_set.begin(), eviction_set.end());
 
@@ -91,28 +552,256 @@ public:
             }
 
             // -- Collect phase --
-            phase_collect(primitive, candidates, eviction_set, chain);
-            eviction_sets.push_back(eviction_set);
+            {
+                phase_scope scope(options.statistics, &build_statistics::collect);
+                phase_collect(primitive, candidates, eviction_set, chain);
+            }
+
+            bool unique = (registry == nullptr) ||
+                publish(primitive, *registry, seen, worker, eviction_set, witness, chain);
+
+            if(!unique){
+                count(options, &build_statistics::duplicates);
+            }
+
+            if(unique){
+                count(options, &build_statistics::successes);
+                if(options.statistics != nullptr){
+                    options.statistics->add_set(eviction_set.size());
+                }
+
+                eviction_sets.push_back({eviction_set, witness});
+
+                if(options.autotune && registry == nullptr &&
+                    eviction_sets.size() == AUTOTUNE_SETS){
+                    primitive.autotune(eviction_sets, chain);
+                }
+
+                if(on_set){
+                    on_set(eviction_sets.back());
+                }
+            }
 
             // Reset attempt count
             attempt = 0;
         }
 
-        // Extend the eviction sets
-        //  For some platforms we only need to discover a subset of the total eviction sets. We are
-        //  able to generate the remaining eviction sets from the discovered subset. For a concrete
-        //  example see l3::extend_elements.
-        std::vector<std::vector<element_t>> all_eviction_sets;
-        for(auto& set : eviction_sets){
-            auto extended = primitive.backend->extend_elements(set);
-            all_eviction_sets.insert(all_eviction_sets.end(), extended.begin(), extended.end());
+        return eviction_sets;
+    }
+
+    // build_for_element
+    //  Construct only an eviction set that evicts target, using target as the witness. Candidates
+    //  are taken from the same page offset as target (see Backend::get_elements(element_class)), so
+    //  target can be any address the backend can access, such as an address in a shared mapping.
+    //
+    //  Returns as soon as an eviction set is found, or an empty vector after ATTEMPT_COUNT failed
+    //  attempts. The witness must stay fixed, so the doubling expand phase is always used.
+    static std::vector<std::vector<element_t>> build_for_element(
+        T& primitive,
+        element_t target,
+        eviction_set_options const& options = {}
+    ){
+        auto element_class = primitive.backend->element_to_class(target);
+
+        std::vector<element_t> candidates = primitive.backend->get_elements(element_class);
+        candidates.erase(
+            std::remove(candidates.begin(), candidates.end(), target),
+            candidates.end()
+        );
+
+        auto g = make_generator(options, 0);
+
+        chain_t chain;
+
+        for(size_t attempt = 1; attempt <= ATTEMPT_COUNT; ++attempt){
+            if(candidates.size() <= EVICTION_SET_SIZE){
+                break;
+            }
+
+            if(options.cancel != nullptr && options.cancel->load(std::memory_order_relaxed)){
+                break;
+            }
+
+            std::vector<element_t> eviction_set;
+            element_t witness;
+
+            // phase_expand_doubling takes its witness from the back of the candidates
+            std::shuffle(candidates.begin(), candidates.end(), g);
+            candidates.push_back(target);
+
+            count(options, &build_statistics::attempts);
+
+            // The witness is always target, it is not returned to the candidates on failure
+            bool expanded;
+            {
+                phase_scope scope(options.statistics, &build_statistics::expand);
+                expanded = phase_expand_doubling(
+                    primitive, candidates, eviction_set, witness, chain);
+            }
+
+            if(!expanded){
+                count(options, &build_statistics::expand_failures);
+                candidates.insert(candidates.end(), eviction_set.begin(), eviction_set.end());
+                continue;
+            }
+
+            bool contracted;
+            {
+                phase_scope scope(options.statistics, &build_statistics::contract);
+                contracted = contract(primitive, candidates, eviction_set, witness, options, chain);
+            }
+
+            if(!contracted){
+                count(options, &build_statistics::contract_failures);
+                candidates.insert(candidates.end(), eviction_set.begin(), eviction_set.end());
+                continue;
+            }
+
+            count(options, &build_statistics::successes);
+            if(options.statistics != nullptr){
+                options.statistics->add_set(eviction_set.size());
+            }
+
+            return {eviction_set};
         }
 
-        // LE DEBUGGING INFO XDDD
-        std::cerr << all_eviction_sets.size() << " sets constructed" << std::endl;
-        std::cerr << std::endl;
+        return {};
+    }
 
-        return all_eviction_sets;
+    // build_for_class
+    //  Construct only the eviction sets for a single page offset class, that is eviction sets that
+    //  evict elements at element_class within a page (see Backend::element_to_class). This builds
+    //  the same base eviction sets as build, but skips extending them to every other class.
+    static std::vector<std::vector<element_t>> build_for_class(
+        T& primitive,
+        size_t element_class,
+        eviction_set_options const& options = {}
+    ){
+        std::vector<element_t> candidates = primitive.backend->get_elements(element_class);
+
+        std::vector<std::vector<element_t>> eviction_sets;
+        for(auto& set : build_base(primitive, candidates, options)){
+            eviction_sets.push_back(set.elements);
+        }
+
+        return eviction_sets;
+    }
+
+    // set_evicts
+    //  Forwards to primitive, counting the call for build_statistics.
+    static bool set_evicts(
+        T& primitive,
+        std::vector<element_t>& eviction_set,
+        element_t witness,
+        chain_t& chain
+    ){
+        evicts_calls += 1;
+        return primitive.set_evicts(eviction_set, witness, chain);
+    }
+
+    // count
+    //  Increment one of the attempt counters of build_statistics, if statistics are collected.
+    static void count(
+        eviction_set_options const& options,
+        std::atomic<uint64_t> build_statistics::* counter
+    ){
+        if(options.statistics != nullptr){
+            (options.statistics->*counter) += 1;
+        }
+    }
+
+    // make_generator
+    //  Returns a generator seeded from options.seed, or a random seed if it is zero. Each stream
+    //  gets a different sequence so that parallel workers do not shuffle identically.
+    static std::mt19937 make_generator(eviction_set_options const& options, size_t stream){
+        if(options.seed == 0){
+            std::random_device rd;
+            return std::mt19937(rd());
+        }
+
+        std::seed_seq seed{options.seed, (uint32_t)stream};
+        return std::mt19937(seed);
+    }
+
+    // contract
+    //  Run the contract phase selected by options. Returns true if the eviction set ends up with an
+    //  acceptable size, EVICTION_SET_SIZE_LOWER to EVICTION_SET_SIZE_UPPER elements.
+    static bool contract(
+        T& primitive,
+        std::vector<element_t>& candidates,
+        std::vector<element_t>& eviction_set,
+        element_t& witness,
+        eviction_set_options const& options,
+        chain_t& chain
+    ){
+        if(options.contract == contract_strategy::group_testing){
+            phase_contract_group(primitive, candidates, eviction_set, witness, chain);
+        } else {
+            for(size_t contract = 0; contract < CONTRACT_COUNT; contract += 1){
+                // Early exit, eviction set is already correct size
+                if(eviction_set.size() <= EVICTION_SET_SIZE_UPPER){
+                    break;
+                }
+                phase_contract(primitive, candidates, eviction_set, witness, chain);
+            }
+        }
+
+        return
+            eviction_set.size() >= EVICTION_SET_SIZE_LOWER &&
+            eviction_set.size() <= EVICTION_SET_SIZE_UPPER;
+    }
+
+    // synchronize
+    //  Remove candidates that are congruent with eviction sets other workers have published since
+    //  the last call to synchronize.
+    static void synchronize(
+        T& primitive,
+        registry_t& registry,
+        typename registry_t::entry*& seen,
+        size_t worker,
+        std::vector<element_t>& candidates,
+        chain_t& chain
+    ){
+        auto head = registry.get_head();
+
+        for(auto entry = head; entry != seen; entry = entry->next){
+            if(entry->owner != worker && !entry->duplicate.load(std::memory_order_relaxed)){
+                phase_collect(primitive, candidates, entry->set, chain);
+            }
+        }
+
+        seen = head;
+    }
+
+    // publish
+    //  Publish an eviction set to the registry. Returns false if another worker published an
+    //  eviction set for the same witness first, in which case the eviction set should be dropped.
+    //
+    //  Sets published before the last call to synchronize have already been collected from our
+    //  candidates, so only the sets published since then need to be checked.
+    static bool publish(
+        T& primitive,
+        registry_t& registry,
+        typename registry_t::entry* seen,
+        size_t worker,
+        std::vector<element_t>& eviction_set,
+        element_t witness,
+        chain_t& chain
+    ){
+        auto published = registry.push(eviction_set, witness, worker);
+
+        for(auto entry = published->next; entry != seen; entry = entry->next){
+            if(entry->owner == worker || entry->duplicate.load(std::memory_order_relaxed)){
+                continue;
+            }
+
+            if(set_evicts(primitive, entry->set, witness, chain)){
+                published->duplicate.store(true, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        return true;
     }
 
     // The purpose of the expand phase is to find a set of elements, known as an eviction set, that
@@ -150,7 +839,7 @@ public:
             witness = candidates.back();
             candidates.pop_back();
 
-            if(primitive.set_evicts(eviction_set, witness, chain)){
+            if(set_evicts(primitive, eviction_set, witness, chain)){
                 return true;
             }
         }
@@ -158,6 +847,68 @@ public:
         return false;
     }
 
+    // The doubling expand phase has the same purpose as the expand phase. Instead of testing after
+    // every added candidate, the eviction set is doubled in size until it evicts the witness. We
+    // then binary search between the last two sizes for the shortest prefix of the eviction set that
+    // still evicts the witness, and return the rest of the eviction set to the candidates.
+    static bool phase_expand_doubling(
+        T& primitive,
+        std::vector<element_t>& candidates,
+        std::vector<element_t>& eviction_set,
+        element_t& witness,
+        chain_t& chain
+    ) {
+        witness = candidates.back();
+        candidates.pop_back();
+
+        // See phase_expand for the reasoning behind the bailout
+        size_t bailout = candidates.size() / 2;
+        if(bailout < EVICTION_SET_SIZE * 10){
+            bailout = candidates.size();
+        }
+
+        size_t lower = 0;
+        size_t upper = std::min((size_t)EVICTION_SET_SIZE, bailout);
+
+        while(true){
+            while(eviction_set.size() < upper){
+                eviction_set.push_back(candidates.back());
+                candidates.pop_back();
+            }
+
+            if(set_evicts(primitive, eviction_set, witness, chain)){
+                break;
+            }
+
+            if(upper >= bailout){
+                return false;
+            }
+
+            lower = upper;
+            upper = std::min(upper * 2, bailout);
+        }
+
+        // Invariant: The prefix of size lower does not evict, the prefix of size upper does.
+        std::vector<element_t> prefix;
+        prefix.reserve(upper);
+
+        while(upper - lower > 1){
+            size_t middle = lower + (upper - lower) / 2;
+            prefix.assign(eviction_set.begin(), eviction_set.begin() + middle);
+
+            if(set_evicts(primitive, prefix, witness, chain)){
+                upper = middle;
+            } else {
+                lower = middle;
+            }
+        }
+
+        candidates.insert(candidates.end(), eviction_set.begin() + upper, eviction_set.end());
+        eviction_set.resize(upper);
+
+        return true;
+    }
+
     // The purpose of the contract phase is to take an eviction set and remove elements that do not
     // contribute to the eviction.
     static void phase_contract(
@@ -173,7 +924,7 @@ public:
             auto element = eviction_set.back();
             eviction_set.pop_back();
 
-            if(primitive.set_evicts(eviction_set, witness, chain)){
+            if(set_evicts(primitive, eviction_set, witness, chain)){
                 candidates.push_back(element);
             } else {
                 if(index >= eviction_set.size()){
@@ -188,23 +939,98 @@ public:
         }
     }
 
+    // The group contract phase has the same purpose as the contract phase, but uses threshold group
+    // testing to do so. The eviction set is split into GROUP_COUNT groups, and every group whose
+    // removal still evicts the witness is moved back into the candidate set, testing each group
+    // against what is left after the groups before it. At most EVICTION_SET_SIZE groups hold an
+    // element the eviction depends on, so every pass at least halves the set, and a pass over
+    // single elements leaves only the ones that are needed.
+    //  See Vila et al. "Theory and Practice of Finding Eviction Sets".
+    //
+    // Stopping at the first removable group instead would cost fewer calls per pass but only shrink
+    // the set by 1/GROUP_COUNT, which takes more calls in total than the linear contract phase for
+    // the set sizes the expand phases produce.
+    //
+    // Returns false if no group could be removed, usually because of noise or an eviction set that
+    // depends on more than EVICTION_SET_SIZE of its elements.
+    static bool phase_contract_group(
+        T& primitive,
+        std::vector<element_t>& candidates,
+        std::vector<element_t>& eviction_set,
+        element_t& witness,
+        chain_t& chain
+    ) {
+        std::vector<element_t> kept;
+        std::vector<element_t> remaining;
+        kept.reserve(eviction_set.size());
+        remaining.reserve(eviction_set.size());
+
+        while(eviction_set.size() > EVICTION_SET_SIZE){
+            size_t size = eviction_set.size();
+            size_t groups = std::min(size, (size_t)GROUP_COUNT);
+
+            kept.clear();
+            for(size_t group = 0; group < groups; group += 1){
+                auto begin = eviction_set.begin() + (group * size / groups);
+                auto end = eviction_set.begin() + ((group + 1) * size / groups);
+
+                // Everything kept so far and every group not tested yet
+                remaining.assign(kept.begin(), kept.end());
+                remaining.insert(remaining.end(), end, eviction_set.end());
+
+                if(set_evicts(primitive, remaining, witness, chain)){
+                    candidates.insert(candidates.end(), begin, end);
+                } else {
+                    kept.insert(kept.end(), begin, end);
+                }
+            }
+
+            if(kept.size() == size){
+                return false;
+            }
+            eviction_set.swap(kept);
+        }
+
+        return true;
+    }
+
     // The purpose of the collect phase is to remove all other elements from the candidate set that
     // map to the same resource as a given eviction set.
+    //
+    // Candidates are tested in batches of T::BATCH_SIZE, so the eviction set is primed once per batch
+    // instead of once per candidate. Candidates can evict each other within a batch when more than
+    // EVICTION_SET_SIZE of them are congruent, so every candidate the batch reports as evicted is
+    // confirmed with set_evicts before it is removed.
     static void phase_collect(
         T& primitive,
         std::vector<element_t>& candidates,
         std::vector<element_t>& eviction_set,
         chain_t& chain
     ){
-        size_t i = 0;
-        while(i < candidates.size()){
-            if(primitive.set_evicts(eviction_set, candidates[i], chain)){
-                candidates[i] = candidates.back();
-                candidates.pop_back();
-            } else {
-                i += 1;
+        size_t read = 0;
+        size_t write = 0;
+
+        while(read < candidates.size()){
+            size_t count = std::min(candidates.size() - read, (size_t)T::BATCH_SIZE);
+            evicts_batch_calls += 1;
+            auto evicted = primitive.set_evicts_batch(
+                eviction_set, &candidates[read], count, chain
+            );
+
+            for(size_t i = 0; i < count; i += 1){
+                bool congruent = ((evicted >> i) & 1) &&
+                    set_evicts(primitive, eviction_set, candidates[read + i], chain);
+
+                if(!congruent){
+                    candidates[write] = candidates[read + i];
+                    write += 1;
+                }
             }
+
+            read += count;
         }
+
+        candidates.resize(write);
     }
 };
 
@@ -1,7 +1,15 @@
 #ifndef SCAT_HEADER_SET_SIGNAL
 #define SCAT_HEADER_SET_SIGNAL
 
+#include <scat/chain.hpp>
+#include <scat/utils.hpp>
+
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 // TODO: Make signal interface nicer
@@ -12,6 +20,192 @@ namespace signal {
 // TODO: Find a home for channel_t
 using channel_t = size_t;
 
+template<typename T>
+struct length {
+    T value;
+    size_t length;
+    size_t start;
+};
+
+// threshold_sample
+//  1 if sample is at least level and 0 otherwise. Missed time slots (negative samples) repeat
+//  previous, the value of the sample before.
+inline int16_t threshold_sample(int16_t sample, int16_t level, int16_t previous){
+    if(sample < 0){
+        return previous;
+    }
+    return (sample >= level) ? 1 : 0;
+}
+
+// run_length_encoder<T>
+//  Incremental samples_to_lengths. Samples are pushed one at a time and each length is passed to
+//  emit once no later sample can change it, which is one run behind the newest sample. Produces
+//  the same lengths as samples_to_lengths over the same samples.
+template<typename T>
+struct run_length_encoder {
+private:
+    size_t minimum_gap;
+    size_t index = 0;
+
+    // The run being extended by new samples
+    length<T> current = {};
+
+    // The last finished run, which absorbs current if current turns out to be a gap
+    length<T> previous = {};
+    bool has_previous = false;
+
+public:
+    run_length_encoder(size_t minimum_gap = 0) : minimum_gap(minimum_gap){
+    }
+
+    template<class Emit>
+    void push(T sample, Emit&& emit){
+        if(index == 0){
+            current = {sample, 0, 0};
+        } else if(sample != current.value){
+            if(current.length <= minimum_gap && has_previous){
+                current.value = previous.value;
+                current.start = previous.start;
+                current.length += previous.length;
+                has_previous = false;
+            } else {
+                if(has_previous){
+                    emit(previous);
+                }
+
+                previous = current;
+                has_previous = true;
+                current = {sample, 0, index};
+            }
+        }
+
+        index += 1;
+        current.length += 1;
+    }
+
+    // flush
+    //  Emit the remaining runs, as samples_to_lengths would at the end of its samples.
+    template<class Emit>
+    void flush(Emit&& emit){
+        if(has_previous){
+            emit(previous);
+            has_previous = false;
+        }
+        if(index > 0){
+            emit(current);
+        }
+        index = 0;
+    }
+
+    // Number of samples pushed since the last flush
+    size_t size() const {
+        return index;
+    }
+};
+
+// run_recording
+//  Thresholded samples (see threshold_sample) stored as runs, see record_runs.
+struct run_recording {
+    std::vector<length<int16_t>> runs;
+
+    // Samples recorded, and how many of them were missed time slots
+    size_t size = 0;
+    size_t missed = 0;
+};
+
+// packed_recording
+//  Thresholded samples (see threshold_sample) stored as one bit each, see record_packed.
+struct packed_recording {
+    std::vector<uint64_t> words;
+
+    // Samples recorded, and how many of them were missed time slots
+    size_t size = 0;
+    size_t missed = 0;
+
+    inline void push(bool bit){
+        if(size % 64 == 0){
+            words.push_back(0);
+        }
+        words.back() |= (uint64_t)bit << (size % 64);
+        size += 1;
+    }
+
+    inline bool operator[](size_t index) const {
+        return (words[index / 64] >> (index % 64)) & 1;
+    }
+
+    // unpack
+    //  One int16_t per sample, as read_channel would return after thresholding.
+    std::vector<int16_t> unpack() const {
+        std::vector<int16_t> samples(size);
+        for(size_t i = 0; i < size; i += 1){
+            samples[i] = (*this)[i];
+        }
+        return samples;
+    }
+};
+
+// record_runs
+//  Record a channel with reader.record_channel and keep only the runs of thresholded samples,
+//  without storing the samples themselves. The same as samples_to_lengths(thresholded,
+//  minimum_gap) over the thresholded samples of read_channel, but memory grows with the number of
+//  transitions rather than the number of samples.
+//
+//  The level is fixed up front, unlike find_in_samples which picks it from the whole recording
+//  (see find_first), so both only produce the same runs if level is the one threshold_samples
+//  would pick and no time slot was missed.
+template<class Reader, class State>
+run_recording record_runs(
+    Reader& reader,
+    State& state,
+    channel_t channel,
+    chain_t& chain,
+    int16_t level = 1,
+    size_t minimum_gap = 0
+){
+    run_recording recording;
+    run_length_encoder<int16_t> encoder(minimum_gap);
+    int16_t value = 0;
+
+    auto emit = [&](length<int16_t> const& run){
+        recording.runs.push_back(run);
+    };
+
+    reader.record_channel(state, channel, chain, [&](int16_t sample){
+        recording.missed += (sample < 0) ? 1 : 0;
+        value = threshold_sample(sample, level, value);
+        encoder.push(value, emit);
+        recording.size += 1;
+    });
+
+    encoder.flush(emit);
+    return recording;
+}
+
+// record_packed
+//  Record a channel with reader.record_channel and keep each thresholded sample as a single bit,
+//  an eighth of a byte rather than the two bytes read_channel stores.
+template<class Reader, class State>
+packed_recording record_packed(
+    Reader& reader,
+    State& state,
+    channel_t channel,
+    chain_t& chain,
+    int16_t level = 1
+){
+    packed_recording recording;
+    recording.words.reserve((reader.sample_count + 63) / 64);
+    int16_t value = 0;
+
+    reader.record_channel(state, channel, chain, [&](int16_t sample){
+        recording.missed += (sample < 0) ? 1 : 0;
+        value = threshold_sample(sample, level, value);
+        recording.push(value);
+    });
+
+    return recording;
+}
+
 template<
     class State,
     class Reader
@@ -41,6 +235,25 @@ public:
         return reader.read_channel(*state, channel, chain);
     }
 
+    // read_runs
+    //  See record_runs.
+    run_recording read_runs(int16_t level = 1, size_t minimum_gap = 0){
+        return record_runs(reader, *state, channel, chain, level, minimum_gap);
+    }
+
+    // read_packed
+    //  See record_packed.
+    packed_recording read_packed(int16_t level = 1){
+        return record_packed(reader, *state, channel, chain, level);
+    }
+
+    // stream
+    //  Record samples until stop is set, passing each one to sink, see capture.
+    template<class Sink>
+    void stream(std::atomic<bool> const& stop, Sink&& sink){
+        reader.stream_channel(*state, channel, chain, stop, sink);
+    }
+
     channel_t get_channel(){
         return channel;
     }
@@ -88,6 +301,20 @@ public:
         return reader.read_channel(*state, channel, chain);
     }
 
+    std::vector<std::vector<sample_t>> read_channels(
+        std::vector<channel_t>& channels
+    ){
+        return reader.read_channels(*state, channels, chain);
+    }
+
+    run_recording read_channel_runs(channel_t channel, int16_t level = 1, size_t minimum_gap = 0){
+        return record_runs(reader, *state, channel, chain, level, minimum_gap);
+    }
+
+    packed_recording read_channel_packed(channel_t channel, int16_t level = 1){
+        return record_packed(reader, *state, channel, chain, level);
+    }
+
     std::vector<channel_t>& get_channels(){
         return channels;
     }
@@ -109,15 +336,110 @@ public:
     }
 };
 
+// streaming_source_group
+//  Like source_group, but for a State whose channels are published while it is still being
+//  constructed (see prime_probe::create_streaming). Iterating get_channels yields each channel as
+//  soon as it is published, blocking until the next channel is available or construction is done.
+//
+//  State must provide wait_for_channel(channel), which blocks until channel is available and
+//  returns false if it never will be.
+template<
+    class State,
+    class Reader
+>
+struct streaming_source_group {
+public:
+    using sample_t = typename Reader::sample_t;
+    using source_t = source<State, Reader>;
 
+    // Input iterator over published channels. Comparing against any other iterator waits for the
+    // current channel, and only compares equal once construction finished without publishing it.
+    struct channel_iterator {
+        State* state;
+        channel_t channel;
 
-template<typename T>
-struct length {
-    T value;
-    size_t length;
-    size_t start;
+        channel_t operator*() const {
+            return channel;
+        }
+
+        channel_iterator& operator++(){
+            channel += 1;
+            return *this;
+        }
+
+        bool operator!=(channel_iterator const&) const {
+            return state->wait_for_channel(channel);
+        }
+    };
+
+    struct channel_range {
+        State* state;
+
+        channel_iterator begin() const {
+            return {state, 0};
+        }
+
+        channel_iterator end() const {
+            return {state, 0};
+        }
+    };
+
+private:
+    chain_t chain;  // TODO: Support universal chain?
+    std::shared_ptr<State> state;
+
+public:
+    Reader reader;
+
+    streaming_source_group(
+        std::shared_ptr<State> state,
+        Reader reader
+    ) : state(state),
+        reader(reader)
+    {
+    }
+
+    // read
+    //  Waits for construction to finish, then reads every channel.
+    std::vector<std::vector<sample_t>> read(
+    ){
+        auto channels = wait_for_channels();
+        return reader.read_channels(*state, channels, chain);
+    };
+
+    std::vector<sample_t> read_channel(
+        channel_t channel
+    ){
+        return reader.read_channel(*state, channel, chain);
+    }
+
+    std::vector<std::vector<sample_t>> read_channels(
+        std::vector<channel_t>& channels
+    ){
+        return reader.read_channels(*state, channels, chain);
+    }
+
+    channel_range get_channels(){
+        return {state.get()};
+    }
+
+    // wait_for_channels
+    //  Waits for construction to finish and returns every channel.
+    std::vector<channel_t> wait_for_channels(){
+        std::vector<channel_t> channels;
+        for(auto channel : get_channels()){
+            channels.push_back(channel);
+        }
+        return channels;
+    }
+
+    source_t channel_to_source(channel_t channel){
+        return source_t(state, reader, channel);
+    }
 };
 
+
+
 template<typename T>
 std::vector<length<T>> samples_to_lengths(
     std::vector<T> const& samples,
@@ -220,9 +542,12 @@ struct signal {
     std::vector<length<int16_t>> data;
     size_t one_timestep;
     size_t zero_timestep;
+
+    // Channel the signal was found on
+    channel_t channel = 0;
 };
 
-std::vector<bool> decode_binary(signal const& signal, size_t bits){
+inline std::vector<bool> decode_binary(signal const& signal, size_t bits){
     std::vector<bool> results;
 
     for(size_t index = signal.end; index < signal.data.size(); ++index){
@@ -244,15 +569,16 @@ std::vector<bool> decode_binary(signal const& signal, size_t bits){
     return results;
 }
 
-template<typename Sources>
-std::unique_ptr<signal> find_first(
-    std::vector<int16_t> known,
-    Sources& sources
+// find_in_samples
+//  Search the samples of a single channel for the known signal, whose lengths are given by
+//  samples_to_lengths(known), see find_first. The samples are thresholded with threshold_samples,
+//  missed time slots become 0, and runs of at most minimum_gap samples are merged into the run
+//  before them.
+inline std::unique_ptr<signal> find_in_samples(
+    std::vector<length<int16_t>> const& signal_lengths,
+    std::vector<int16_t> data,
+    size_t minimum_gap = 6
 ){
-    auto signal_lengths = samples_to_lengths(known);
-
-    size_t minimum_gap = 6;
-
     size_t zero_signal_sum = 0;
     size_t one_signal_sum = 0;
 
@@ -264,63 +590,278 @@ std::unique_ptr<signal> find_first(
         }
     }
 
-    for(auto source : sources.get_channels()){
-        auto data = sources.read_channel(source);
-        data = threshold_samples(data);
-        auto lengths = samples_to_lengths(data, minimum_gap);
+    data = threshold_samples(data);
+    auto lengths = samples_to_lengths(data, minimum_gap);
 
-        // Find singal from lengths
-        size_t window_start = 0;
-        size_t window_end = signal_lengths.size();
+    // Find singal from lengths
+    size_t window_start = 0;
+    size_t window_end = signal_lengths.size();
 
-        while(window_end < lengths.size()){
-            size_t zero_window_sum = 0;
-            size_t one_window_sum = 0;
+    while(window_end < lengths.size()){
+        size_t zero_window_sum = 0;
+        size_t one_window_sum = 0;
 
-            for(size_t index = window_start; index < window_end; ++index){
-                if(lengths[index].value == 0){
-                    zero_window_sum += lengths[index].length;
-                } else {
-                    one_window_sum += lengths[index].length;
-                }
+        for(size_t index = window_start; index < window_end; ++index){
+            if(lengths[index].value == 0){
+                zero_window_sum += lengths[index].length;
+            } else {
+                one_window_sum += lengths[index].length;
             }
+        }
 
-            size_t one_timestep = one_window_sum / one_signal_sum;
-            size_t zero_timestep = zero_window_sum / zero_signal_sum;
-            float max_tolerance = 0;
+        size_t one_timestep = one_window_sum / one_signal_sum;
+        size_t zero_timestep = zero_window_sum / zero_signal_sum;
+        float max_tolerance = 0;
 
-            // Compare the window with our signal
-            for(size_t index = window_start; index < window_end; ++index){
-                size_t timestep = (lengths[index].value == 0) ? zero_timestep : one_timestep;
-                size_t s = signal_lengths[index - window_start].length * timestep;
-                size_t w = lengths[index].length;
+        // Compare the window with our signal
+        for(size_t index = window_start; index < window_end; ++index){
+            size_t timestep = (lengths[index].value == 0) ? zero_timestep : one_timestep;
+            size_t s = signal_lengths[index - window_start].length * timestep;
+            size_t w = lengths[index].length;
 
-                size_t difference = (s > w) ? (s - w) : (w - s);
-                float tolerance = ((float)difference) / s;
-                if(tolerance >= max_tolerance){
-                    max_tolerance = tolerance;
-                }
+            size_t difference = (s > w) ? (s - w) : (w - s);
+            float tolerance = ((float)difference) / s;
+            if(tolerance >= max_tolerance){
+                max_tolerance = tolerance;
             }
+        }
+
+        if(max_tolerance <= 0.4){
+            auto result = std::make_unique<signal>();
+            result->start = window_start;
+            result->end = window_end;
+            result->data = lengths;
+            result->one_timestep = one_timestep;
+            result->zero_timestep = zero_timestep;
+            return result;
+        }
+
+        window_start += 1;
+        window_end += 1;
+    }
+
+    return nullptr;
+}
+
+// find_in_channels
+//  Read channels from sources with a single call to read_channels and search each of them for the
+//  known signal, see find_in_samples.
+template<typename Sources>
+std::unique_ptr<signal> find_in_channels(
+    std::vector<length<int16_t>> const& signal_lengths,
+    Sources& sources,
+    std::vector<channel_t>& channels
+){
+    auto recordings = sources.read_channels(channels);
 
-            if(max_tolerance <= 0.4){
-                auto result = std::make_unique<signal>();
-                result->start = window_start;
-                result->end = window_end;
-                result->data = lengths;
-                result->one_timestep = one_timestep;
-                result->zero_timestep = zero_timestep;
+    for(size_t i = 0; i < recordings.size(); i += 1){
+        auto result = find_in_samples(signal_lengths, std::move(recordings[i]));
+        if(result){
+            result->channel = channels[i];
+            return result;
+        }
+    }
+
+    return nullptr;
+}
+
+// find_first
+//  Read channels from sources until one contains the known signal. Channels are read
+//  sources.reader.get_group_size() at a time, so a reader that records several channels at once
+//  (see prime_probe::reader_interleaved) scans the cache in a fraction of the time once a
+//  slot_controller has shortened its slots.
+//
+//  Channels are recorded with read_channels and searched with find_in_samples rather than
+//  recorded as runs (record_runs), so the runs differ from record_runs' in two ways. The level is
+//  the one that splits the whole recording most evenly, which is only known once recording ends,
+//  while record_runs thresholds each sample as it arrives. And missed time slots count as 0
+//  rather than repeating the previous sample. read_channels is also what lets a reader record a
+//  group of channels at once. The cost is a full recording in memory per channel of the group.
+template<typename Sources>
+std::unique_ptr<signal> find_first(
+    std::vector<int16_t> known,
+    Sources& sources
+){
+    auto signal_lengths = samples_to_lengths(known);
+
+    size_t group = sources.reader.get_group_size();
+    std::vector<channel_t> channels;
+
+    for(auto channel : sources.get_channels()){
+        channels.push_back(channel);
+
+        if(channels.size() >= group){
+            if(auto result = find_in_channels(signal_lengths, sources, channels)){
                 return result;
             }
-
-            window_start += 1;
-            window_end += 1;
+            channels.clear();
         }
     }
 
+    if(!channels.empty()){
+        return find_in_channels(signal_lengths, sources, channels);
+    }
+
     return nullptr;
 }
 
-std::vector<int16_t> repeat(std::vector<int16_t>&& input, size_t count){
+struct scan_options {
+    // Worker threads, all available cores if 0
+    size_t thread_count = 0;
+
+    // Worker i is pinned to core first_core + i, see utils::pin_current_thread
+    bool pin = true;
+    size_t first_core = 0;
+};
+
+// has_controller<Reader>
+//  True if Reader paces its slots with a controller (see prime_probe::slot_controller).
+template<class Reader, class = void>
+struct has_controller : std::false_type {};
+
+template<class Reader>
+struct has_controller<Reader, std::void_t<decltype(std::declval<Reader&>().controller)>> :
+    std::true_type {};
+
+// find_first_parallel
+//  Same as find_first, but channels are spread across options.thread_count workers. Each worker
+//  copies sources, so it records with its own chain_t and reader while sharing the eviction sets,
+//  and is pinned to its own core. A controller must only be used by one thread, so a reader's
+//  controller is copied for every worker as well. What the copies learn is discarded.
+//
+//  Every worker starts on its own contiguous range of channels, and once its range is empty steals
+//  half of the largest remaining range, so that a worker slowed down by a noisy core does not hold
+//  up the scan. Workers stop as soon as any of them finds the signal, after finishing the recording
+//  in progress. The returned signal is not necessarily on the lowest matching channel.
+//
+//  The reader must be safe to use from several threads on a shared state, which the prime_probe
+//  readers are for the hardware backends. A streaming source group is only scanned once every
+//  channel has been published.
+template<typename Sources>
+std::unique_ptr<signal> find_first_parallel(
+    std::vector<int16_t> known,
+    Sources& sources,
+    scan_options const& options = {}
+){
+    // A range of channels owned by a worker, [begin, end) of all
+    struct range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    auto signal_lengths = samples_to_lengths(known);
+
+    std::vector<channel_t> all;
+    for(auto channel : sources.get_channels()){
+        all.push_back(channel);
+    }
+
+    size_t thread_count = options.thread_count;
+    if(thread_count == 0){
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    thread_count = std::max(std::min(thread_count, all.size()), (size_t)1);
+
+    std::vector<range> ranges(thread_count);
+    for(size_t worker = 0; worker < thread_count; worker += 1){
+        ranges[worker].begin = all.size() * worker / thread_count;
+        ranges[worker].end = all.size() * (worker + 1) / thread_count;
+    }
+
+    std::atomic<bool> found{false};
+    std::mutex result_mutex;
+    std::unique_ptr<signal> result;
+
+    // take
+    //  Move up to count channels from the front of worker's range into channels, stealing half of
+    //  the largest other range first if worker's range is empty.
+    auto take = [&](size_t worker, size_t count, std::vector<channel_t>& channels){
+        auto& own = ranges[worker];
+
+        while(true){
+            {
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if(own.begin < own.end){
+                    while(channels.size() < count && own.begin < own.end){
+                        channels.push_back(all[own.begin]);
+                        own.begin += 1;
+                    }
+                    return;
+                }
+            }
+
+            size_t victim = worker;
+            size_t largest = 0;
+            for(size_t other = 0; other < thread_count; other += 1){
+                std::lock_guard<std::mutex> lock(ranges[other].mutex);
+                if(ranges[other].end - ranges[other].begin > largest){
+                    largest = ranges[other].end - ranges[other].begin;
+                    victim = other;
+                }
+            }
+
+            if(largest == 0){
+                return;
+            }
+
+            // Take the back half, the victim keeps working through the front
+            std::scoped_lock lock(own.mutex, ranges[victim].mutex);
+            auto& stolen = ranges[victim];
+            size_t size = stolen.end - stolen.begin;
+            if(size > 0 && own.begin == own.end){
+                own.end = stolen.end;
+                own.begin = stolen.end - (size + 1) / 2;
+                stolen.end = own.begin;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(size_t worker = 0; worker < thread_count; worker += 1){
+        workers.emplace_back([&, worker]{
+            if(options.pin){
+                utils::pin_current_thread(options.first_core + worker);
+            }
+
+            Sources local = sources;
+            size_t group = local.reader.get_group_size();
+
+            std::shared_ptr<void> controller;
+            if constexpr(has_controller<decltype(local.reader)>::value){
+                if(local.reader.controller != nullptr){
+                    using controller_t = std::decay_t<decltype(*local.reader.controller)>;
+                    auto copy = std::make_shared<controller_t>(*local.reader.controller);
+                    local.reader.controller = copy.get();
+                    controller = copy;
+                }
+            }
+            std::vector<channel_t> channels;
+
+            while(!found.load()){
+                channels.clear();
+                take(worker, group, channels);
+                if(channels.empty()){
+                    return;
+                }
+
+                auto match = find_in_channels(signal_lengths, local, channels);
+                if(match && !found.exchange(true)){
+                    std::lock_guard<std::mutex> lock(result_mutex);
+                    result = std::move(match);
+                }
+            }
+        });
+    }
+
+    for(auto& thread : workers){
+        thread.join();
+    }
+
+    return result;
+}
+
+inline std::vector<int16_t> repeat(std::vector<int16_t>&& input, size_t count){
     std::vector<int16_t> output;
 
     for(size_t i = 0; i < count; ++i){
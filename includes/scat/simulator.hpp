@@ -0,0 +1,373 @@
+// A software model of a sliced, set associative last level cache.
+//
+// simulator::cache and simulator::timer can be used in place of a real Backend and Timer, for
+//  example evicter<simulator::cache<>, simulator::timer>. Accessing an element runs it through the
+//  model and advances a virtual clock by the hit or miss latency, which simulator::timer reads. The
+//  results only depend on the config (including its seed), so eviction set construction and readers
+//  can be tested and benchmarked reproducibly on any machine.
+//
+// The model only covers the last level cache. Elements are virtual addresses in a simulated
+//  buffer, which is mapped page by page onto random physical frames, so only the page offset bits
+//  of the set index are known, as with prime_probe::cache.
+//
+// Accesses to the model are serialized, so eviction sets can be constructed with several threads
+//  (eviction_set_options::thread_count). Each thread has its own virtual clock, but the results
+//  then depend on how the threads are scheduled and are only reproducible with a single thread.
+#ifndef SCAT_HEADER_SIMULATOR
+#define SCAT_HEADER_SIMULATOR
+
+#include <scat/chain.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace scat {
+namespace simulator {
+
+// clock
+//  The virtual time of the calling thread, advanced by simulated accesses and timer reads.
+struct clock {
+    static inline thread_local uint64_t ticks = 0;
+};
+
+enum class replacement_policy {
+    // Evict the least recently used line.
+    lru,
+
+    // Binary tree pseudo LRU, each node points away from the most recently used half. Requires a
+    // power of two number of ways.
+    tree_plru,
+
+    // Quad-age LRU (QLRU_H00_M1_R0_U0). Lines are inserted with age 1 and reset to age 0 on a hit.
+    // The first line of age 3 is evicted, if there is none every age is raised until there is.
+    qlru,
+};
+
+struct config {
+    size_t slices = 4;
+    size_t sets_per_slice = 1024;
+    replacement_policy policy = replacement_policy::lru;
+
+    // Size of the simulated buffer that elements are allocated from
+    size_t buffer_size = 16 * 1024 * 1024;
+
+    uint64_t hit_latency = 40;
+    uint64_t miss_latency = 200;
+    uint64_t timer_latency = 20;
+
+    // Noise, a uniformly distributed 0 to jitter ticks are added to every access, and every access
+    // evicts a random line from a random set with probability interference.
+    uint64_t jitter = 0;
+    double interference = 0.0;
+
+    uint64_t seed = 1;
+};
+
+// timer
+//  Reads the virtual clock. Every read costs config::timer_latency ticks, so busy waiting on the
+//  timer (as reader_eviction_count::probe does) makes progress.
+struct timer {
+public:
+    typedef uint64_t ticks_t;
+
+    static inline uint64_t latency = config().timer_latency;
+
+    inline ticks_t get_ticks(chain_t& chain){
+        clock::ticks += latency;
+        return clock::ticks;
+    }
+};
+
+template<size_t Ways = 16>
+struct cache {
+public:
+    using element_t = uint64_t;
+    using set_t = std::vector<element_t>;
+
+    static const size_t EVICTION_SET_SIZE = Ways;
+
+    static const size_t LINE_SIZE = 64;
+    static const size_t PAGE_SIZE = 4096;
+
+    // Base of the simulated virtual address space, purely cosmetic.
+    static const uint64_t VIRTUAL_BASE = 0x7f0000000000;
+
+    // Physical frames are picked from this many bits of physical address space.
+    static const size_t PHYSICAL_BITS = 34;
+
+    // Location of a line in the model
+    struct location {
+        size_t slice;
+        size_t set;
+
+        bool operator==(location const& other) const {
+            return slice == other.slice && set == other.set;
+        }
+    };
+
+private:
+    static const uint64_t INVALID = ~(uint64_t)0;
+
+    struct cache_set {
+        std::array<uint64_t, Ways> lines;
+        std::array<uint64_t, Ways> state;
+        uint64_t plru;
+    };
+
+    config settings;
+    std::mt19937_64 random;
+
+    std::vector<cache_set> sets;
+    std::vector<uint64_t> frames;
+    std::vector<element_t> elements;
+
+    uint64_t stamp = 0;
+
+    std::mutex mutex;
+
+public:
+    cache(config settings = {}) : settings(settings), random(settings.seed){
+        timer::latency = settings.timer_latency;
+
+        sets.resize(settings.slices * settings.sets_per_slice);
+        for(auto& set : sets){
+            set.lines.fill(INVALID);
+            set.state.fill(0);
+            set.plru = 0;
+        }
+
+        // Map every virtual page onto a distinct random physical frame
+        size_t pages = settings.buffer_size / PAGE_SIZE;
+        uint64_t frame_count = ((uint64_t)1 << PHYSICAL_BITS) / PAGE_SIZE;
+        std::uniform_int_distribution<uint64_t> frame(0, frame_count - 1);
+        std::unordered_set<uint64_t> used;
+
+        while(frames.size() < pages){
+            auto f = frame(random);
+            if(used.insert(f).second){
+                frames.push_back(f);
+            }
+        }
+
+        for(size_t page = 0; page < pages; page += 1){
+            elements.push_back(VIRTUAL_BASE + page * PAGE_SIZE);
+        }
+    }
+
+    inline void access_element(element_t element, chain_t& chain){
+        std::lock_guard<std::mutex> lock(mutex);
+
+        bool hit = access(translate(element) / LINE_SIZE);
+
+        clock::ticks += hit ? settings.hit_latency : settings.miss_latency;
+
+        if(settings.jitter > 0){
+            clock::ticks += random() % (settings.jitter + 1);
+        }
+
+        if(settings.interference > 0){
+            std::uniform_real_distribution<double> chance(0.0, 1.0);
+            if(chance(random) < settings.interference){
+                auto& set = sets[random() % sets.size()];
+                set.lines[random() % Ways] = INVALID;
+            }
+        }
+    }
+
+    // write_element
+    //  The model does not distinguish reads from writes.
+    inline void write_element(element_t element, chain_t& chain){
+        access_element(element, chain);
+    }
+
+    // flush_element
+    //  Remove element from the model, the equivalent of clflush.
+    void flush_element(element_t element){
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto line = translate(element) / LINE_SIZE;
+        auto& set = sets[index(line)];
+
+        for(auto& l : set.lines){
+            if(l == line){
+                l = INVALID;
+            }
+        }
+    }
+
+    std::vector<element_t>& get_elements(){
+        return elements;
+    }
+
+    // See prime_probe::cache::element_to_offset, offsets are measured in lines
+    size_t element_to_offset(element_t element){
+        return (element - VIRTUAL_BASE) / LINE_SIZE;
+    }
+
+    // See prime_probe::cache::offset_to_element, returns 0 if offset is outside of the buffer
+    element_t offset_to_element(size_t offset){
+        return (offset < settings.buffer_size / LINE_SIZE) ? VIRTUAL_BASE + offset * LINE_SIZE : 0;
+    }
+
+    // See prime_probe::cache::element_to_class
+    size_t element_to_class(element_t element){
+        return (element % PAGE_SIZE) / LINE_SIZE;
+    }
+
+    // See prime_probe::cache::get_elements(element_class)
+    std::vector<element_t> get_elements(size_t element_class){
+        std::vector<element_t> shifted;
+        for(auto element : elements){
+            shifted.push_back(element + element_class * LINE_SIZE);
+        }
+        return shifted;
+    }
+
+    std::vector<std::vector<element_t>> extend_elements(std::vector<element_t> const& elements){
+        std::vector<std::vector<element_t>> extended;
+
+        for(size_t offset = 0; offset < PAGE_SIZE; offset += LINE_SIZE){
+            std::vector<element_t> set;
+            for(auto element : elements){
+                set.push_back(element + offset);
+            }
+            extended.push_back(set);
+        }
+
+        return extended;
+    }
+
+    size_t get_buffer_size(){
+        return settings.buffer_size;
+    }
+
+    char const* get_page_type(){
+        return "simulated";
+    }
+
+    // locate
+    //  Where element lives in the model. Two elements are congruent if their locations are equal.
+    location locate(element_t element){
+        auto line = translate(element) / LINE_SIZE;
+        return {slice(line), line % settings.sets_per_slice};
+    }
+
+    config const& get_config(){
+        return settings;
+    }
+
+private:
+    uint64_t translate(element_t element){
+        auto offset = element - VIRTUAL_BASE;
+        return frames[(offset / PAGE_SIZE) % frames.size()] * PAGE_SIZE + offset % PAGE_SIZE;
+    }
+
+    // slice
+    //  The complex addressing function of Intel processors with up to 8 slices, as reverse
+    //  engineered by Maurice et al. "Reverse Engineering Intel Last-Level Cache Complex Addressing
+    //  Using Performance Counters". Each output bit is the parity of the masked physical address.
+    size_t slice(uint64_t line){
+        static const uint64_t MASKS[] = {0x1B5F575440, 0x2EB5FAA880, 0x3CCCC93100};
+
+        auto address = line * LINE_SIZE;
+        size_t result = 0;
+
+        for(size_t bit = 0; ((size_t)1 << bit) < settings.slices && bit < 3; bit += 1){
+            result |= (size_t)__builtin_parityll(address & MASKS[bit]) << bit;
+        }
+
+        return result % settings.slices;
+    }
+
+    size_t index(uint64_t line){
+        return slice(line) * settings.sets_per_slice + line % settings.sets_per_slice;
+    }
+
+    // access
+    //  Run a line through the model, returns true on a hit.
+    bool access(uint64_t line){
+        auto& set = sets[index(line)];
+
+        for(size_t way = 0; way < Ways; way += 1){
+            if(set.lines[way] == line){
+                touch(set, way, true);
+                return true;
+            }
+        }
+
+        size_t way = victim(set);
+        set.lines[way] = line;
+        touch(set, way, false);
+        return false;
+    }
+
+    void touch(cache_set& set, size_t way, bool hit){
+        switch(settings.policy){
+        case replacement_policy::lru:
+            stamp += 1;
+            set.state[way] = stamp;
+            break;
+
+        case replacement_policy::tree_plru: {
+            size_t node = 0;
+            for(size_t size = Ways; size > 1; size /= 2){
+                bool right = (way % size) >= size / 2;
+                uint64_t bit = (uint64_t)1 << node;
+
+                // Point the node away from the half that was just used
+                set.plru = right ? (set.plru & ~bit) : (set.plru | bit);
+                node = 2 * node + 1 + right;
+            }
+            break;
+        }
+
+        case replacement_policy::qlru:
+            set.state[way] = hit ? 0 : 1;
+            break;
+        }
+    }
+
+    size_t victim(cache_set& set){
+        for(size_t way = 0; way < Ways; way += 1){
+            if(set.lines[way] == INVALID){
+                return way;
+            }
+        }
+
+        switch(settings.policy){
+        case replacement_policy::lru:
+            return std::min_element(set.state.begin(), set.state.end()) - set.state.begin();
+
+        case replacement_policy::tree_plru: {
+            size_t node = 0;
+            size_t way = 0;
+            for(size_t size = Ways; size > 1; size /= 2){
+                bool right = (set.plru >> node) & 1;
+                way = way * 2 + right;
+                node = 2 * node + 1 + right;
+            }
+            return way;
+        }
+
+        case replacement_policy::qlru: {
+            auto oldest = *std::max_element(set.state.begin(), set.state.end());
+            for(auto& age : set.state){
+                age += 3 - oldest;
+            }
+            return std::find(set.state.begin(), set.state.end(), 3) - set.state.begin();
+        }
+        }
+
+        return 0;
+    }
+};
+
+} // namespace simulator
+} // namespace scat
+
+#endif // SCAT_HEADER_SIMULATOR
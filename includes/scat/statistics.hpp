@@ -0,0 +1,421 @@
+// Allocation free order statistics for the hot paths of eviction set construction and
+//  calibration.
+//
+// sample_buffer keeps its samples in a fixed size array on the stack, and select picks the
+//  requested percentile with a sorting network for small buffers and nth_element otherwise, so
+//  neither allocates nor fully sorts. p2_quantile estimates a percentile of an unbounded stream in
+//  constant space, for measurements that run too long to keep every sample. histogram counts
+//  values in fixed bins and splits them into two classes with Otsu's method.
+//
+// Percentiles follow the convention of scat::utils::sample, the sample at index
+//  round(size * percentile) of the sorted samples, clamped to the last sample.
+#ifndef SCAT_HEADER_STATISTICS
+#define SCAT_HEADER_STATISTICS
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace scat {
+namespace statistics {
+
+// Ranges up to this size are ordered with a sorting network rather than nth_element
+static const size_t SORTING_NETWORK_LIMIT = 16;
+
+// quantile_index
+//  Index of percentile in a sorted range of size elements.
+inline size_t quantile_index(float percentile, size_t size){
+    if(size == 0){
+        return 0;
+    }
+
+    auto index = std::llround(size * percentile);
+    if(index < 0){
+        return 0;
+    }
+    return ((size_t)index >= size) ? size - 1 : (size_t)index;
+}
+
+// compare_exchange
+//  Order a and b. Compilers turn this into conditional moves for arithmetic types.
+template<class T>
+inline void compare_exchange(T& a, T& b){
+    T low = (b < a) ? b : a;
+    T high = (b < a) ? a : b;
+    a = low;
+    b = high;
+}
+
+// sorting_network
+//  Sort [begin, begin + size) with an odd-even transposition network. size rounds of independent
+//  compare exchanges, with no data dependent branches.
+template<class Iterator>
+void sorting_network(Iterator begin, size_t size){
+    for(size_t round = 0; round < size; round += 1){
+        for(size_t i = round % 2; i + 1 < size; i += 2){
+            compare_exchange(begin[i], begin[i + 1]);
+        }
+    }
+}
+
+// select
+//  Reorders [begin, end) so that the element at percentile is in its sorted position and returns
+//  it. The rest of the range is left partially ordered. An empty range returns a value initialized
+//  element (zero for arithmetic types).
+template<class Iterator>
+typename std::iterator_traits<Iterator>::value_type select(
+    float percentile,
+    Iterator begin,
+    Iterator end
+){
+    size_t size = end - begin;
+    size_t index = quantile_index(percentile, size);
+
+    if(size == 0){
+        return typename std::iterator_traits<Iterator>::value_type{};
+    }
+
+    if(size <= SORTING_NETWORK_LIMIT){
+        sorting_network(begin, size);
+    } else {
+        std::nth_element(begin, begin + index, end);
+    }
+
+    return begin[index];
+}
+
+// sample_buffer<T, Capacity>
+//  Up to Capacity samples stored inline. Samples pushed while the buffer is full are dropped.
+template<class T, size_t Capacity>
+struct sample_buffer {
+public:
+    static const size_t CAPACITY = Capacity;
+
+private:
+    std::array<T, Capacity> samples;
+    size_t count = 0;
+
+public:
+    inline void push(T const& sample){
+        if(count < Capacity){
+            samples[count] = sample;
+            count += 1;
+        }
+    }
+
+    inline void clear(){
+        count = 0;
+    }
+
+    inline size_t size() const {
+        return count;
+    }
+
+    inline bool full() const {
+        return count == Capacity;
+    }
+
+    T* begin(){
+        return samples.data();
+    }
+
+    T* end(){
+        return samples.data() + count;
+    }
+
+    // select
+    //  Returns the sample at percentile, see statistics::select. Reorders the samples.
+    T select(float percentile){
+        return statistics::select(percentile, begin(), end());
+    }
+};
+
+// sample<Capacity>(percentile, count, fn, args...)
+//  Calls fn count times and returns the result at percentile, like scat::utils::sample but without
+//  allocating. count is capped at Capacity. A count of zero returns a value initialized result
+//  without calling fn.
+template<size_t Capacity, class Fn, class... Args>
+typename std::result_of<Fn(Args...)>::type sample(
+    float percentile,
+    size_t count,
+    Fn&& fn,
+    Args&&... args
+){
+    sample_buffer<typename std::result_of<Fn(Args...)>::type, Capacity> buffer;
+
+    count = std::min(count, Capacity);
+    for(size_t i = 0; i < count; i += 1){
+        buffer.push(fn(std::forward<Args>(args)...));
+    }
+
+    return buffer.select(percentile);
+}
+
+// p2_quantile
+//  Streaming estimate of a single percentile using the P² algorithm, Jain and Chlamtac "The P²
+//  Algorithm for Dynamic Calculation of Quantiles and Histograms Without Storing Observations".
+//  Five markers track the minimum, the percentile, the maximum and two points in between, and are
+//  moved along a piecewise parabola as samples arrive. Constant space and time per sample.
+struct p2_quantile {
+private:
+    static const size_t MARKERS = 5;
+
+    double percentile;
+    size_t count = 0;
+
+    // Marker heights, actual positions and desired positions
+    double heights[MARKERS];
+    double positions[MARKERS];
+    double desired[MARKERS];
+    double increments[MARKERS];
+
+public:
+    p2_quantile(double percentile = 0.5) : percentile(percentile){
+        for(size_t i = 0; i < MARKERS; i += 1){
+            positions[i] = (double)i;
+        }
+
+        desired[0] = 0;
+        desired[1] = 2 * percentile;
+        desired[2] = 4 * percentile;
+        desired[3] = 2 + 2 * percentile;
+        desired[4] = 4;
+
+        increments[0] = 0;
+        increments[1] = percentile / 2;
+        increments[2] = percentile;
+        increments[3] = (1 + percentile) / 2;
+        increments[4] = 1;
+    }
+
+    void add(double sample){
+        // Collect the first samples exactly
+        if(count < MARKERS){
+            heights[count] = sample;
+            count += 1;
+
+            if(count == MARKERS){
+                std::sort(heights, heights + MARKERS);
+            }
+            return;
+        }
+
+        count += 1;
+
+        // Find the cell the sample falls into, extending the extremes if needed
+        size_t cell;
+        if(sample < heights[0]){
+            heights[0] = sample;
+            cell = 0;
+        } else if(sample >= heights[MARKERS - 1]){
+            heights[MARKERS - 1] = sample;
+            cell = MARKERS - 2;
+        } else {
+            cell = 0;
+            while(sample >= heights[cell + 1]){
+                cell += 1;
+            }
+        }
+
+        for(size_t i = cell + 1; i < MARKERS; i += 1){
+            positions[i] += 1;
+        }
+        for(size_t i = 0; i < MARKERS; i += 1){
+            desired[i] += increments[i];
+        }
+
+        // Move the middle markers towards their desired positions
+        for(size_t i = 1; i < MARKERS - 1; i += 1){
+            double offset = desired[i] - positions[i];
+
+            bool up = offset >= 1 && positions[i + 1] - positions[i] > 1;
+            bool down = offset <= -1 && positions[i - 1] - positions[i] < -1;
+            if(!up && !down){
+                continue;
+            }
+
+            double step = up ? 1 : -1;
+            double height = parabolic(i, step);
+
+            if(heights[i - 1] < height && height < heights[i + 1]){
+                heights[i] = height;
+            } else {
+                heights[i] = linear(i, step);
+            }
+            positions[i] += step;
+        }
+    }
+
+    // get
+    //  Returns the current estimate, exact while fewer than five samples have been added.
+    double get() const {
+        if(count >= MARKERS){
+            return heights[2];
+        }
+        if(count == 0){
+            return 0;
+        }
+
+        double sorted[MARKERS];
+        std::copy(heights, heights + count, sorted);
+        return statistics::select((float)percentile, sorted, sorted + count);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    double parabolic(size_t i, double step) const {
+        double left = positions[i] - positions[i - 1];
+        double right = positions[i + 1] - positions[i];
+
+        return heights[i] + step / (positions[i + 1] - positions[i - 1]) * (
+            (left + step) * (heights[i + 1] - heights[i]) / right +
+            (right - step) * (heights[i] - heights[i - 1]) / left
+        );
+    }
+
+    double linear(size_t i, double step) const {
+        size_t other = (step > 0) ? i + 1 : i - 1;
+        double slope = (heights[other] - heights[i]) / (positions[other] - positions[i]);
+        return heights[i] + step * slope;
+    }
+};
+
+// histogram<Bins>
+//  Counts of values in Bins bins of width each, starting at zero. Values past the last bin are
+//  counted in the last bin.
+template<size_t Bins>
+struct histogram {
+public:
+    static const size_t BINS = Bins;
+
+    // otsu_result
+    //  See otsu.
+    struct otsu_result {
+        // Values at or above threshold belong to the upper class
+        uint64_t threshold = 0;
+
+        // Between class variance over total variance, from 0 (no separation) to 1 (two spikes)
+        double separation = 0;
+    };
+
+private:
+    std::array<uint32_t, Bins> counts = {};
+    uint64_t width;
+    uint64_t total = 0;
+
+public:
+    histogram(uint64_t width = 1) : width(std::max(width, (uint64_t)1)){
+    }
+
+    inline void add(uint64_t value){
+        counts[bin(value)] += 1;
+        total += 1;
+    }
+
+    // merge
+    //  Add every value counted by other, which must have the same width.
+    void merge(histogram const& other){
+        for(size_t i = 0; i < Bins; i += 1){
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+    }
+
+    // count_below
+    //  Number of values counted below value, rounded to a bin boundary.
+    uint64_t count_below(uint64_t value) const {
+        if(value / width >= Bins){
+            return total;
+        }
+
+        uint64_t count = 0;
+        for(size_t i = 0; i < value / width; i += 1){
+            count += counts[i];
+        }
+        return count;
+    }
+
+    // decay
+    //  Halve every count, so that older values weigh less than the ones added next.
+    void decay(){
+        total = 0;
+        for(auto& count : counts){
+            count /= 2;
+            total += count;
+        }
+    }
+
+    uint64_t size() const {
+        return total;
+    }
+
+    uint64_t get_width() const {
+        return width;
+    }
+
+    inline size_t bin(uint64_t value) const {
+        return std::min(value / width, (uint64_t)Bins - 1);
+    }
+
+    // otsu
+    //  Split the values into two classes with Otsu's method, "A Threshold Selection Method from
+    //  Gray-Level Histograms". Picks the bin boundary that maximizes the variance between the
+    //  classes.
+    otsu_result otsu() const {
+        otsu_result result;
+        if(total == 0){
+            return result;
+        }
+
+        double sum = 0;
+        double squares = 0;
+        for(size_t i = 0; i < Bins; i += 1){
+            sum += (double)i * counts[i];
+            squares += (double)i * i * counts[i];
+        }
+
+        double n = (double)total;
+        double mean = sum / n;
+        double variance = squares / n - mean * mean;
+
+        double lower_count = 0;
+        double lower_sum = 0;
+        double best = -1;
+
+        for(size_t i = 0; i + 1 < Bins; i += 1){
+            lower_count += counts[i];
+            lower_sum += (double)i * counts[i];
+
+            double upper_count = n - lower_count;
+            if(lower_count == 0 || upper_count == 0){
+                continue;
+            }
+
+            double lower_mean = lower_sum / lower_count;
+            double upper_mean = (sum - lower_sum) / upper_count;
+            double between = lower_count * upper_count * (lower_mean - upper_mean) *
+                (lower_mean - upper_mean) / (n * n);
+
+            if(between > best){
+                best = between;
+                result.threshold = (i + 1) * width;
+                result.separation = (variance > 0) ? between / variance : 0;
+            }
+        }
+
+        return result;
+    }
+};
+
+} // namespace statistics
+} // namespace scat
+
+#endif // SCAT_HEADER_STATISTICS
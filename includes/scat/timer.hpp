@@ -2,9 +2,19 @@
 #define SCAT_HEADER_TIMER
 
 #include <scat/chain.hpp>
+#include <scat/statistics.hpp>
+#include <scat/utils.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <time.h>
 
 namespace scat {
 namespace timer {
@@ -31,6 +41,152 @@ public:
     }
 };
 
+enum class fence {
+    // Waits for every earlier instruction to complete locally, loads included
+    lfence,
+
+    // Also waits for earlier stores to become globally visible, slower than lfence
+    mfence,
+};
+
+// fenced_rdtsc<Ticks, Fence>
+//  rdtsc preceded by a fence, for hosts where rdtscp is slow or trapped by the hypervisor. Like
+//  rdtscp the read happens after every earlier instruction, later instructions may still start
+//  before it. Ticks is uint32_t or uint64_t, see rdtscp32 and rdtscp64.
+template<class Ticks, fence Fence>
+struct fenced_rdtsc {
+public:
+    typedef Ticks ticks_t;
+
+    inline ticks_t get_ticks(chain_t& chain){
+        uint32_t eax, edx;
+        if constexpr(Fence == fence::lfence){
+            asm volatile ("lfence\n\trdtsc": "=a" (eax), "=d" (edx) :: "memory");
+        } else {
+            asm volatile ("mfence\n\trdtsc": "=a" (eax), "=d" (edx) :: "memory");
+        }
+        return (ticks_t)(((uint64_t)edx << 32) | eax);
+    }
+};
+
+using lfence_rdtsc32 = fenced_rdtsc<uint32_t, fence::lfence>;
+using lfence_rdtsc64 = fenced_rdtsc<uint64_t, fence::lfence>;
+using mfence_rdtsc32 = fenced_rdtsc<uint32_t, fence::mfence>;
+using mfence_rdtsc64 = fenced_rdtsc<uint64_t, fence::mfence>;
+
+// counting_thread
+//  A timer for hosts without a usable time stamp counter. A background thread increments a counter
+//  on its own cache line as fast as it can, and get_ticks reads it. The thread is shared by every
+//  counting_thread and runs while at least one exists.
+//
+//  Ticks only advance while the counting thread is running, so it needs a core to itself. It is
+//  pinned to core if core is set before the first counting_thread is constructed. The tick rate
+//  depends on the core and on contention for the counter's cache line, calibrate it with
+//  realtime_calibration like any other timer.
+struct counting_thread {
+public:
+    typedef uint64_t ticks_t;
+
+    static const size_t CACHE_LINE = 64;
+    static const size_t NO_CORE = ~(size_t)0;
+
+    // Core the counting thread is pinned to, NO_CORE to leave it unpinned
+    inline static size_t core = NO_CORE;
+
+private:
+    struct shared_t {
+        alignas(CACHE_LINE) std::atomic<uint64_t> count{0};
+        alignas(CACHE_LINE) std::atomic<bool> stop{false};
+
+        std::mutex mutex;
+        size_t users = 0;
+        std::thread thread;
+    };
+
+    static shared_t& shared(){
+        static shared_t instance;
+        return instance;
+    }
+
+public:
+    counting_thread(){
+        acquire();
+    }
+
+    counting_thread(counting_thread const&){
+        acquire();
+    }
+
+    counting_thread& operator=(counting_thread const&) = default;
+
+    ~counting_thread(){
+        release();
+    }
+
+    inline ticks_t get_ticks(chain_t& chain){
+        return shared().count.load(std::memory_order_acquire);
+    }
+
+private:
+    static void acquire(){
+        auto& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        s.users += 1;
+        if(s.users > 1){
+            return;
+        }
+
+        s.stop.store(false);
+        s.thread = std::thread([&s]{
+            if(core != NO_CORE){
+                utils::pin_current_thread(core);
+            }
+
+            // Only this thread writes the counter, a plain store avoids a locked increment
+            uint64_t count = s.count.load(std::memory_order_relaxed);
+            while(!s.stop.load(std::memory_order_relaxed)){
+                count += 1;
+                s.count.store(count, std::memory_order_release);
+            }
+        });
+
+        // Wait for the first tick, so that a timer is never read before it starts counting
+        auto start = s.count.load();
+        while(s.count.load() == start){
+            std::this_thread::yield();
+        }
+    }
+
+    static void release(){
+        auto& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        s.users -= 1;
+        if(s.users > 0){
+            return;
+        }
+
+        s.stop.store(true);
+        s.thread.join();
+    }
+};
+
+// monotonic_raw
+//  clock_gettime(CLOCK_MONOTONIC_RAW) in nanoseconds, the fallback when neither the time stamp
+//  counter nor a spare core for counting_thread is available. Usually served by the vDSO without a
+//  system call, but far slower and coarser than rdtsc.
+struct monotonic_raw {
+public:
+    typedef uint64_t ticks_t;
+
+    inline ticks_t get_ticks(chain_t& chain){
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+        return (ticks_t)time.tv_sec * 1000000000 + time.tv_nsec;
+    }
+};
+
 // realtime_calibration<Timer>
 //  Attempt to calibrate Timer against high_resolution_clock, so that Timer ticks can be converted
 //  to realtime and back.
@@ -42,18 +198,22 @@ struct realtime_calibration {
         typename Timer::ticks_t ticks;
 
         // We need to support less than operator so that settings_t can be ordered (required for
-        //  scat::utils::sample, or any other sorted container of settings_t)
-        bool operator<(settings_t other){
+        //  scat::statistics::sample, or any other sorted container of settings_t)
+        bool operator<(settings_t const& other) const {
             return ratio < other.ratio;
         }
     };
 
+    // calibrate keeps its samples on the stack, sample_count is capped at this
+    static const size_t SAMPLE_CAPACITY = 16;
+
     inline static bool calibrated = false;
     inline static settings_t settings;
 
     // calibrate
     //  Forcefully calibrate the timer against high_resolution_clock, writes the results to settings
-    //  and returns it.
+    //  and returns it. sample_count is capped at SAMPLE_CAPACITY, zero leaves settings value
+    //  initialized.
     static settings_t& calibrate(
         Timer& timer,
         std::chrono::nanoseconds calibration_length,
@@ -61,14 +221,16 @@ struct realtime_calibration {
         size_t sample_count,
         chain_t& chain
     ){
-        settings = scat::utils::sample(sample_point, sample_count, [&]{
+        settings = statistics::sample<SAMPLE_CAPACITY>(sample_point, sample_count, [&]{
             auto clock_start = std::chrono::high_resolution_clock::now();
             auto timer_start = timer.get_ticks(chain);
 
             auto clock_end = clock_start;
             auto timer_end = timer_start;
 
-            while(clock_end - clock_start < calibration_length){
+            // Coarse timers (monotonic_raw, counting_thread without a core of its own) may not
+            // advance within calibration_length, keep going until they do
+            while(clock_end - clock_start < calibration_length || timer_end == timer_start){
                 clock_end = std::chrono::high_resolution_clock::now();
                 timer_end = timer.get_ticks(chain);
             }
@@ -86,7 +248,8 @@ struct realtime_calibration {
 
     // calibrate
     //  Forcefully calibrate the timer against high_resolution_clock, writes the results to settings
-    //  and returns it.
+    //  and returns it. sample_count is capped at SAMPLE_CAPACITY, zero leaves settings value
+    //  initialized.
     static settings_t& calibrate(){
         if(calibrated){
             return settings;
@@ -115,6 +278,118 @@ std::chrono::nanoseconds ticks_to_realtime(typename Timer::ticks_t ticks){
     return (int64_t)ticks * settings.realtime / settings.ticks;
 }
 
+// characterization
+//  Result of characterize, all tick counts are in the timer's ticks.
+struct characterization {
+    // Back to back reads measured
+    size_t samples = 0;
+
+    // Ticks between back to back reads, the cost of a timer read, at increasing percentiles
+    uint64_t overhead_minimum = 0;
+    uint64_t overhead_median = 0;
+    uint64_t overhead_90 = 0;
+    uint64_t overhead_99 = 0;
+    uint64_t overhead_maximum = 0;
+
+    // Smallest step between two reads that differed, and the fraction of reads equal to the read
+    // before them. A coarse timer has a large resolution and many equal reads.
+    uint64_t resolution = 0;
+    double repeated = 0;
+
+    // Reads that were smaller than the read before them and can not be explained by a wrap
+    uint64_t violations = 0;
+
+    // Reads that were smaller than the read before them because ticks_t wrapped around
+    uint64_t wraps = 0;
+
+    // Width of ticks_t, and how long it takes to wrap around (zero for 64 bit timers)
+    size_t bits = 0;
+    std::chrono::nanoseconds wrap_period{0};
+
+    // Nanoseconds per tick, from realtime_calibration
+    double ratio = 0;
+};
+
+// characterize<Timer>
+//  Read timer samples + 1 times back to back and describe the differences between consecutive
+//  reads, see characterization. overhead_median is the amount to subtract from latencies measured
+//  with Timer to get the latency of the measured code alone, see
+//  prime_probe::reader_eviction_count::subtract_timer_overhead.
+template<class Timer>
+characterization characterize(Timer& timer, size_t samples, chain_t& chain){
+    using ticks_t = typename Timer::ticks_t;
+
+    static const size_t BITS = sizeof(ticks_t) * 8;
+
+    characterization result;
+    result.samples = samples;
+    result.bits = BITS;
+
+    std::vector<uint64_t> steps;
+    steps.reserve(samples);
+
+    // Read into a buffer first, so that the bookkeeping does not end up between the reads
+    std::vector<ticks_t> reads(samples + 1);
+    for(auto& read : reads){
+        read = timer.get_ticks(chain);
+    }
+
+    uint64_t repeated = 0;
+    for(size_t i = 1; i < reads.size(); i += 1){
+        ticks_t step = reads[i] - reads[i - 1];
+
+        if(reads[i] < reads[i - 1]){
+            // A narrow timer that wrapped has only moved forward by a little, modulo 2^BITS
+            if(BITS < 64 && step < ((ticks_t)1 << (BITS - 1))){
+                result.wraps += 1;
+            } else {
+                result.violations += 1;
+                continue;
+            }
+        }
+
+        if(step == 0){
+            repeated += 1;
+        } else if(result.resolution == 0 || step < result.resolution){
+            result.resolution = step;
+        }
+        steps.push_back(step);
+    }
+
+    result.repeated = (samples > 0) ? (double)repeated / samples : 0;
+
+    if(steps.size() > 0){
+        auto percentile = [&](float p){
+            return statistics::select(p, steps.begin(), steps.end());
+        };
+
+        result.overhead_minimum = *std::min_element(steps.begin(), steps.end());
+        result.overhead_maximum = *std::max_element(steps.begin(), steps.end());
+        result.overhead_median = percentile(0.5);
+        result.overhead_90 = percentile(0.9);
+        result.overhead_99 = percentile(0.99);
+    }
+
+    auto settings = realtime_calibration<Timer>::calibrate();
+    result.ratio = (double)settings.realtime.count() / settings.ticks;
+
+    if(BITS < 64){
+        result.wrap_period = std::chrono::nanoseconds(
+            (int64_t)(std::ldexp(1.0, BITS) * result.ratio)
+        );
+    }
+
+    return result;
+}
+
+// characterize<Timer>
+//  Same as characterize(timer, samples, chain) with a fresh timer and chain.
+template<class Timer>
+characterization characterize(size_t samples = 100000){
+    Timer timer;
+    chain_t chain;
+    return characterize(timer, samples, chain);
+}
 
 } // namespace timer
 } // namespace scat
@@ -2,9 +2,18 @@
 #define SCAT_HEADER_UTILS
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <memory>
+#include <thread>
 #include <vector>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace scat {
 namespace utils {
 
@@ -70,6 +79,153 @@ std::vector<typename std::result_of<Fn(Args...)>::type> sample(
     return outputs;
 }
 
+/* pin_current_thread(core)
+ *  Restrict the calling thread to a single core, wrapping around if core is larger than the number
+ *  of cores available. Returns false if the thread could not be pinned, or on platforms where
+ *  pinning is not supported.
+ */
+inline bool pin_current_thread(size_t core){
+#ifdef __linux__
+    size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/* append_only_vector<T>
+ *  A vector that one thread appends to while other threads read from it without locking. Items are
+ *  stored in chunks of ChunkSize that never move, so references to items below size() stay valid
+ *  while appending. Calls to push_back must be serialized by the caller.
+ */
+template<class T, size_t ChunkSize = 256, size_t ChunkCount = 4096>
+struct append_only_vector {
+private:
+    std::unique_ptr<std::atomic<T*>[]> chunks;
+    std::atomic<size_t> count{0};
+
+public:
+    append_only_vector() : chunks(new std::atomic<T*>[ChunkCount]){
+        for(size_t i = 0; i < ChunkCount; i += 1){
+            chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    append_only_vector(append_only_vector const&) = delete;
+    append_only_vector& operator=(append_only_vector const&) = delete;
+
+    ~append_only_vector(){
+        for(size_t i = 0; i < ChunkCount; i += 1){
+            delete[] chunks[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // push_back
+    //  Returns false if the vector is full (ChunkSize * ChunkCount items).
+    bool push_back(T const& value){
+        size_t index = count.load(std::memory_order_relaxed);
+        size_t chunk = index / ChunkSize;
+
+        if(chunk >= ChunkCount){
+            return false;
+        }
+
+        T* items = chunks[chunk].load(std::memory_order_relaxed);
+        if(items == nullptr){
+            items = new T[ChunkSize];
+            chunks[chunk].store(items, std::memory_order_relaxed);
+        }
+
+        items[index % ChunkSize] = value;
+        count.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return count.load(std::memory_order_acquire);
+    }
+
+    T& operator[](size_t index){
+        return chunks[index / ChunkSize].load(std::memory_order_relaxed)[index % ChunkSize];
+    }
+};
+
+/* spsc_ring<T, Capacity>
+ *  A lock free ring buffer between exactly one producer and one consumer thread. Capacity must be a
+ *  power of two. Each side keeps a cached copy of the other side's index and only reloads it when
+ *  the ring looks full (or short of items), so the indices' cache lines are not bounced on every
+ *  item.
+ */
+template<class T, size_t Capacity>
+struct spsc_ring {
+public:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity is a power of 2");
+
+    static const size_t CAPACITY = Capacity;
+    static const size_t CACHE_LINE = 64;
+
+private:
+    static const size_t MASK = Capacity - 1;
+
+    // Written by the producer
+    alignas(CACHE_LINE) std::atomic<size_t> head{0};
+    size_t cached_tail = 0;
+
+    // Written by the consumer
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+
+    alignas(CACHE_LINE) std::array<T, Capacity> items;
+
+public:
+    // try_push
+    //  Producer only. Returns false without blocking if the ring is full.
+    inline bool try_push(T const& value){
+        size_t index = head.load(std::memory_order_relaxed);
+
+        if(index - cached_tail == Capacity){
+            cached_tail = tail.load(std::memory_order_acquire);
+            if(index - cached_tail == Capacity){
+                return false;
+            }
+        }
+
+        items[index & MASK] = value;
+        head.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // pop
+    //  Consumer only. Move up to count items into output and return how many were moved.
+    inline size_t pop(T* output, size_t count){
+        size_t index = tail.load(std::memory_order_relaxed);
+
+        if(cached_head - index < count){
+            cached_head = head.load(std::memory_order_acquire);
+        }
+
+        count = std::min(count, cached_head - index);
+        for(size_t i = 0; i < count; i += 1){
+            output[i] = items[(index + i) & MASK];
+        }
+
+        tail.store(index + count, std::memory_order_release);
+        return count;
+    }
+
+    // size
+    //  Number of items in the ring, exact only when called from the producer or consumer while
+    //  the other side is idle.
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+};
+
 } // namespace utils
 } // namespace scat
 
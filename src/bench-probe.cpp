@@ -0,0 +1,156 @@
+// bench-probe
+//  Compare the cost of probing with reader_eviction_count, reader_linked_list, reader_aggregate,
+//  reader_unrolled and reader_interleaved, and print the results as JSON on stdout.
+//
+//  Usage: bench-probe [--samples n] [--channels n] [--group n]
+//
+//  Each reader records --samples samples from --channels sets at a range of sample lengths, and
+//  the fraction of missed time slots is reported for each length. The shortest sample length with
+//  at most 1% missed slots is the fastest rate the reader can sustain. Sets are groups of page
+//  aligned elements rather than constructed eviction sets, this measures the cost of a probe and
+//  not its accuracy.
+//
+//  reader_interleaved probes --group sets in every time slot. Its sample length is per channel, a
+//  slot lasts the sample length times the number of channels sharing it, so channel_length (kept
+//  for older result files) equals min_sample_length.
+//
+//  controlled_sample_length is the sample length slot_controller::calibrate picks for the first
+//  channel, for reader_interleaved the length of a slot holding only that channel.
+//
+//  unrolled and unrolled_aggregate are reader_unrolled with each timing_mode, to be compared with
+//  eviction_count and aggregate, the generic readers with the same timing. kernel_channels is the
+//  number of channels they probed with the kernel for kernel_size, the rest used the generic loops.
+#include <scat/prime_probe.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using backend_t = scat::prime_probe::cache;
+using rdtscp_t = scat::timer::rdtscp32;
+using state_t = scat::prime_probe::state<
+    backend_t, rdtscp_t, scat::prime_probe::evicter<backend_t, rdtscp_t>
+>;
+
+using eviction_count_t = scat::prime_probe::reader_eviction_count<state_t>;
+using linked_list_t = scat::prime_probe::reader_linked_list<state_t>;
+using aggregate_t = scat::prime_probe::reader_aggregate<state_t>;
+using unrolled_t = scat::prime_probe::reader_unrolled<state_t>;
+using interleaved_t = scat::prime_probe::reader_interleaved<state_t>;
+
+static const double MISSED_LIMIT = 0.01;
+
+template<class Reader>
+void run(char const* name, state_t& state, size_t samples, size_t channels, Reader reader = {}){
+    scat::chain_t chain;
+
+    reader.sample_count = samples;
+    reader.prepare(state, chain);
+
+    std::vector<scat::prime_probe::channel_t> all;
+    for(size_t channel = 0; channel < channels; channel += 1){
+        all.push_back(channel);
+    }
+
+    std::cout << "\"" << name << "\": {\"missed\": {";
+
+    rdtscp_t::ticks_t fastest = 0;
+    bool first = true;
+
+    rdtscp_t::ticks_t step = 128;
+
+    for(rdtscp_t::ticks_t length = 32 * step; length >= step; length -= step){
+        reader.set_sample_length(length);
+
+        size_t missed = 0;
+        for(auto& recording : reader.read_channels(state, all, chain)){
+            missed += std::count(recording.begin(), recording.end(), Reader::MISSED_TIME_SLOT);
+        }
+
+        double rate = (double)missed / (samples * channels);
+        if(rate <= MISSED_LIMIT){
+            fastest = length;
+        }
+
+        std::cout << (first ? "" : ", ") << "\"" << length << "\": " << rate;
+        first = false;
+    }
+
+    // What slot_controller settles on for the first channel, comparable to min_sample_length
+    scat::prime_probe::slot_controller controller;
+    controller.target_miss_rate = MISSED_LIMIT;
+    auto controlled = controller.calibrate(reader, state, 0, chain);
+
+    std::cout << "}, \"min_sample_length\": " << fastest
+              << ", \"channel_length\": " << fastest
+              << ", \"controlled_sample_length\": " << controlled << "}";
+}
+
+int main(int argc, char** argv){
+    size_t samples = 2000;
+    size_t channels = 16;
+    size_t group = 4;
+
+    for(int i = 1; i + 1 < argc; i += 2){
+        std::string flag = argv[i];
+        if(flag == "--samples"){
+            samples = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if(flag == "--channels"){
+            channels = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if(flag == "--group"){
+            group = std::strtoul(argv[i + 1], nullptr, 10);
+        } else {
+            std::cerr << "Unknown argument " << flag << std::endl;
+            return 1;
+        }
+    }
+
+    state_t state;
+    state.backend = std::make_unique<backend_t>();
+    state.timer = std::make_unique<rdtscp_t>();
+
+    auto elements = state.backend->get_elements();
+    std::shuffle(elements.begin(), elements.end(), std::mt19937(1));
+
+    size_t size = backend_t::EVICTION_SET_SIZE;
+    channels = std::min(channels, elements.size() / size);
+
+    for(size_t channel = 0; channel < channels; channel += 1){
+        state.sets.push_back(backend_t::set_t(
+            elements.begin() + channel * size,
+            elements.begin() + (channel + 1) * size
+        ));
+    }
+
+    std::cout << "{\"samples\": " << samples << ", \"channels\": " << channels << ", ";
+    run<eviction_count_t>("eviction_count", state, samples, channels);
+    std::cout << ", ";
+    run<linked_list_t>("linked_list", state, samples, channels);
+    std::cout << ", ";
+    run<aggregate_t>("aggregate", state, samples, channels);
+    std::cout << ", ";
+
+    unrolled_t unrolled;
+    run<unrolled_t>("unrolled", state, samples, channels, unrolled);
+    std::cout << ", ";
+    unrolled.timing = scat::prime_probe::timing_mode::aggregate;
+    run<unrolled_t>("unrolled_aggregate", state, samples, channels, unrolled);
+    std::cout << ", ";
+
+    // Channels the unrolled readers actually probed with a kernel, the rest used the generic loops
+    scat::chain_t chain;
+    unrolled.timing = scat::prime_probe::timing_mode::element;
+    unrolled.prepare(state, chain);
+    std::cout << "\"kernel_size\": " << unrolled.kernel_size << ", "
+              << "\"kernel_channels\": " << unrolled.kernel_channels << ", ";
+
+    interleaved_t interleaved;
+    interleaved.group_size = group;
+    run<interleaved_t>("interleaved", state, samples, channels, interleaved);
+    std::cout << ", \"group\": " << interleaved.get_group_size() << "}" << std::endl;
+
+    return 0;
+}
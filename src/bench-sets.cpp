@@ -0,0 +1,172 @@
+// bench-sets
+//  Construct eviction sets once and print the builder's statistics as JSON on stdout, so that
+//  construction speed can be compared across strategies and machines.
+//
+//  Usage: bench-sets [--backend cache|hugepage|simulator] [--expand linear|doubling]
+//                    [--contract linear|group] [--threads n] [--seed n] [--sets n]
+//                    [--evicter vector|linked] [--autotune 0|1]
+//
+//  --sets n adds the time it took to construct the first n eviction sets to the output. The
+//  simulator backend is deterministic for a fixed seed and a single thread. The linked evicter
+//  (see prime_probe::linked_evicter) is not available on the simulator and only supports a single
+//  thread.
+#include <scat/prime_probe.hpp>
+#include <scat/set_construction.hpp>
+#include <scat/simulator.hpp>
+#include <scat/timer.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+struct arguments {
+    std::string backend = "cache";
+    std::string expand = "doubling";
+    std::string contract = "group";
+    std::string evicter = "vector";
+    size_t threads = 1;
+    uint32_t seed = 0;
+    size_t sets = 0;
+    bool autotune = false;
+};
+
+bool parse(int argc, char** argv, arguments& args){
+    for(int i = 1; i < argc; i += 1){
+        std::string flag = argv[i];
+        if(i + 1 >= argc){
+            std::cerr << "Missing value for " << flag << std::endl;
+            return false;
+        }
+
+        std::string value = argv[++i];
+        if(flag == "--backend"){
+            args.backend = value;
+        } else if(flag == "--expand"){
+            args.expand = value;
+        } else if(flag == "--contract"){
+            args.contract = value;
+        } else if(flag == "--evicter"){
+            args.evicter = value;
+        } else if(flag == "--threads"){
+            args.threads = std::strtoul(value.c_str(), nullptr, 10);
+        } else if(flag == "--seed"){
+            args.seed = std::strtoul(value.c_str(), nullptr, 10);
+        } else if(flag == "--sets"){
+            args.sets = std::strtoul(value.c_str(), nullptr, 10);
+        } else if(flag == "--autotune"){
+            args.autotune = (value != "0");
+        } else {
+            std::cerr << "Unknown argument " << flag << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<class Evicter, class Backend, class Timer>
+void run(arguments const& args, Backend& backend, Timer& timer){
+    using evicter_t = Evicter;
+
+    scat::chain_t chain;
+    evicter_t evicter(&backend, &timer, chain);
+
+    scat::build_statistics statistics;
+
+    scat::eviction_set_options options;
+    options.expand = (args.expand == "linear") ?
+        scat::expand_strategy::linear : scat::expand_strategy::doubling;
+    options.contract = (args.contract == "linear") ?
+        scat::contract_strategy::linear : scat::contract_strategy::group_testing;
+    options.thread_count = args.threads;
+    options.seed = args.seed;
+    options.statistics = &statistics;
+    options.autotune = args.autotune;
+
+    auto candidates = backend.get_elements();
+    scat::eviction_set_builder<evicter_t>::build_base(evicter, candidates, options);
+
+    std::chrono::duration<double> total = scat::build_statistics::clock_t::now() -
+        statistics.start;
+
+    std::cout << "{\"backend\": \"" << args.backend << "\", "
+              << "\"page_type\": \"" << backend.get_page_type() << "\", "
+              << "\"buffer_size\": " << backend.get_buffer_size() << ", "
+              << "\"expand\": \"" << args.expand << "\", "
+              << "\"contract\": \"" << args.contract << "\", "
+              << "\"evicter\": \"" << args.evicter << "\", "
+              << "\"threads\": " << args.threads << ", "
+              << "\"seed\": " << args.seed << ", "
+              << "\"autotune\": " << (args.autotune ? "true" : "false") << ", "
+              << "\"threshold\": " << evicter.threshold << ", "
+              << "\"seconds\": " << total.count() << ", ";
+
+    if(args.sets > 0){
+        auto time = statistics.get_time_to_sets(args.sets);
+        std::cout << "\"time_to_sets\": {\"sets\": " << args.sets << ", \"seconds\": ";
+        if(time < 0){
+            std::cout << "null";
+        } else {
+            std::cout << time;
+        }
+        std::cout << "}, ";
+    }
+
+    std::cout << "\"statistics\": ";
+    statistics.write_json(std::cout);
+    std::cout << "}" << std::endl;
+}
+
+template<class Backend, class Timer>
+void run_with_evicter(arguments const& args, Backend& backend, Timer& timer){
+    if(args.evicter == "linked"){
+        run<scat::prime_probe::linked_evicter<Backend, Timer>>(args, backend, timer);
+    } else {
+        run<scat::prime_probe::evicter<Backend, Timer>>(args, backend, timer);
+    }
+}
+
+int main(int argc, char** argv){
+    arguments args;
+    if(!parse(argc, argv, args)){
+        return 1;
+    }
+
+    if(args.evicter != "vector" && args.evicter != "linked"){
+        std::cerr << "Unknown evicter " << args.evicter << std::endl;
+        return 1;
+    }
+
+    if(args.evicter == "linked" && args.threads > 1){
+        std::cerr << "The linked evicter only supports a single thread" << std::endl;
+        return 1;
+    }
+
+    if(args.backend == "cache"){
+        scat::prime_probe::cache backend;
+        scat::timer::rdtscp32 timer;
+        run_with_evicter(args, backend, timer);
+    } else if(args.backend == "hugepage"){
+        scat::prime_probe::hugepage_cache backend;
+        scat::timer::rdtscp32 timer;
+        run_with_evicter(args, backend, timer);
+    } else if(args.backend == "simulator"){
+        if(args.evicter != "vector"){
+            std::cerr << "The simulator backend only supports the vector evicter" << std::endl;
+            return 1;
+        }
+
+        scat::simulator::config config;
+        config.seed = (args.seed == 0) ? 1 : args.seed;
+
+        scat::simulator::cache<> backend(config);
+        scat::simulator::timer timer;
+        run<scat::prime_probe::evicter<decltype(backend), decltype(timer)>>(args, backend, timer);
+    } else {
+        std::cerr << "Unknown backend " << args.backend << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+// bench-timer
+//  Characterize every timer in scat::timer on this host (see timer::characterize) and print the
+//  results as JSON on stdout, to pick the fastest adequate timer and to size sample_length and
+//  thresholds.
+//
+//  Usage: bench-timer [--samples n] [--core n]
+//
+//  overhead_* are the ticks between back to back reads at increasing percentiles, *_ns the same
+//  converted with realtime_calibration. --core pins counting_thread's counter to a core, it only
+//  gives useful results if that core is otherwise idle.
+#include <scat/timer.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+template<class Timer>
+void run(char const* name, size_t samples){
+    auto result = scat::timer::characterize<Timer>(samples);
+
+    auto ns = [&](uint64_t ticks){
+        return ticks * result.ratio;
+    };
+
+    std::cout << "\"" << name << "\": {"
+              << "\"bits\": " << result.bits << ", "
+              << "\"ns_per_tick\": " << result.ratio << ", "
+              << "\"overhead_minimum\": " << result.overhead_minimum << ", "
+              << "\"overhead_median\": " << result.overhead_median << ", "
+              << "\"overhead_90\": " << result.overhead_90 << ", "
+              << "\"overhead_99\": " << result.overhead_99 << ", "
+              << "\"overhead_maximum\": " << result.overhead_maximum << ", "
+              << "\"overhead_median_ns\": " << ns(result.overhead_median) << ", "
+              << "\"overhead_99_ns\": " << ns(result.overhead_99) << ", "
+              << "\"resolution\": " << result.resolution << ", "
+              << "\"resolution_ns\": " << ns(result.resolution) << ", "
+              << "\"repeated\": " << result.repeated << ", "
+              << "\"violations\": " << result.violations << ", "
+              << "\"wraps\": " << result.wraps << ", "
+              << "\"wrap_period_ns\": " << result.wrap_period.count() << "}";
+}
+
+int main(int argc, char** argv){
+    size_t samples = 100000;
+
+    for(int i = 1; i + 1 < argc; i += 2){
+        std::string flag = argv[i];
+        if(flag == "--samples"){
+            samples = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if(flag == "--core"){
+            scat::timer::counting_thread::core = std::strtoul(argv[i + 1], nullptr, 10);
+        } else {
+            std::cerr << "Unknown argument " << flag << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "{\"samples\": " << samples << ", ";
+    run<scat::timer::rdtscp32>("rdtscp32", samples);
+    std::cout << ", ";
+    run<scat::timer::rdtscp64>("rdtscp64", samples);
+    std::cout << ", ";
+    run<scat::timer::lfence_rdtsc32>("lfence_rdtsc32", samples);
+    std::cout << ", ";
+    run<scat::timer::lfence_rdtsc64>("lfence_rdtsc64", samples);
+    std::cout << ", ";
+    run<scat::timer::mfence_rdtsc32>("mfence_rdtsc32", samples);
+    std::cout << ", ";
+    run<scat::timer::mfence_rdtsc64>("mfence_rdtsc64", samples);
+    std::cout << ", ";
+    run<scat::timer::counting_thread>("counting_thread", samples);
+    std::cout << ", ";
+    run<scat::timer::monotonic_raw>("monotonic_raw", samples);
+    std::cout << "}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <scat/prime_probe.hpp>
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+using element_t = scat::prime_probe::cache::element;
+
+TEST_CASE("link_set links a circular doubly linked list"){
+    std::vector<element_t> buffer(5);
+
+    std::vector<element_t*> set;
+    for(auto& element : buffer){
+        set.push_back(&element);
+    }
+
+    scat::prime_probe::link_set(set);
+
+    for(size_t i = 0; i < set.size(); i += 1){
+        REQUIRE(set[i]->next == set[(i + 1) % set.size()]);
+        REQUIRE(set[i]->next->prev == set[i]);
+    }
+
+    REQUIRE(scat::prime_probe::traverse<true>(set[0], 2) == set[2]);
+    REQUIRE(scat::prime_probe::traverse<false>(set[0], 2) == set[3]);
+    REQUIRE(scat::prime_probe::traverse<true>(set[1], set.size()) == set[1]);
+}
+
+// Records the order elements are accessed in
+struct recording_backend {
+    std::vector<int> reads;
+    std::vector<int> writes;
+
+    void access_element(int element, scat::chain_t& chain){
+        reads.push_back(element);
+    }
+
+    void write_element(int element, scat::chain_t& chain){
+        writes.push_back(element);
+    }
+};
+
+TEST_CASE("access_pattern slides windows over the set"){
+    std::vector<int> set = {0, 1, 2, 3, 4};
+    scat::chain_t chain;
+
+    SECTION("default strategy accesses the set twice in order"){
+        recording_backend backend;
+        scat::prime_probe::eviction_strategy strategy;
+
+        scat::prime_probe::access_pattern(backend, set.begin(), set.end(), strategy, chain);
+        REQUIRE(backend.reads == std::vector<int>{0, 1, 2, 3, 4, 0, 1, 2, 3, 4});
+        REQUIRE(backend.reads.size() == strategy.get_accesses(set.size()));
+    }
+
+    SECTION("overlapping windows"){
+        recording_backend backend;
+        scat::prime_probe::eviction_strategy strategy;
+        strategy.repetitions = 1;
+        strategy.count = 2;
+        strategy.distance = 3;
+        strategy.step = 2;
+
+        scat::prime_probe::access_pattern(backend, set.begin(), set.end(), strategy, chain);
+        REQUIRE(backend.reads == std::vector<int>{0, 1, 2, 0, 1, 2, 2, 3, 4, 2, 3, 4});
+        REQUIRE(backend.reads.size() == strategy.get_accesses(set.size()));
+    }
+
+    SECTION("alternating writes"){
+        recording_backend backend;
+        scat::prime_probe::eviction_strategy strategy;
+        strategy.order = scat::prime_probe::access_order::alternating;
+        strategy.write = true;
+
+        scat::prime_probe::access_pattern(backend, set.begin(), set.end(), strategy, chain);
+        REQUIRE(backend.reads.empty());
+        REQUIRE(backend.writes == std::vector<int>{0, 1, 2, 3, 4, 4, 3, 2, 1, 0});
+    }
+}
@@ -0,0 +1,376 @@
+#include <scat/chain.hpp>
+#include <scat/capture.hpp>
+#include <scat/signal.hpp>
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+using scat::signal::channel_t;
+
+// Recordings of flat noise, except for one channel that repeats the known signal
+struct fake_sources {
+    struct reader_t {
+        size_t group_size = 1;
+
+        // Stands in for a slot_controller, find_first_parallel copies it for each worker
+        int* controller = nullptr;
+
+        size_t get_group_size() const {
+            return group_size;
+        }
+    };
+
+    reader_t reader;
+    channel_t target = 0;
+    size_t channel_count = 0;
+    std::vector<int16_t> known;
+
+    std::shared_ptr<std::atomic<size_t>> reads = std::make_shared<std::atomic<size_t>>(0);
+
+    // Controllers the recordings were made with
+    struct controllers_t {
+        std::mutex mutex;
+        std::set<int*> seen;
+    };
+    std::shared_ptr<controllers_t> controllers = std::make_shared<controllers_t>();
+
+    std::vector<channel_t> get_channels(){
+        std::vector<channel_t> channels;
+        for(channel_t channel = 0; channel < channel_count; channel += 1){
+            channels.push_back(channel);
+        }
+        return channels;
+    }
+
+    std::vector<std::vector<int16_t>> read_channels(std::vector<channel_t>& channels){
+        std::vector<std::vector<int16_t>> recordings;
+
+        {
+            std::lock_guard<std::mutex> lock(controllers->mutex);
+            controllers->seen.insert(reader.controller);
+        }
+
+        for(auto channel : channels){
+            *reads += 1;
+
+            std::vector<int16_t> samples(40, 0);
+            if(channel == target){
+                samples = scat::signal::repeat(std::vector<int16_t>(known), 4);
+
+                // Stretch every sample so that short runs are not filtered as gaps
+                std::vector<int16_t> stretched;
+                for(auto sample : samples){
+                    stretched.insert(stretched.end(), 8, (int16_t)(sample * 8));
+                }
+                samples = stretched;
+            }
+            recordings.push_back(samples);
+        }
+
+        return recordings;
+    }
+};
+
+fake_sources make_sources(channel_t target, size_t channel_count){
+    fake_sources sources;
+    sources.target = target;
+    sources.channel_count = channel_count;
+    sources.known = {1, 0, 1, 0, 1, 1, 1, 0, 0, 0};
+    return sources;
+}
+
+TEST_CASE("signal::find_first reads channels in groups"){
+    auto sources = make_sources(37, 100);
+    sources.reader.group_size = 8;
+
+    auto result = scat::signal::find_first(sources.known, sources);
+
+    REQUIRE(result);
+    REQUIRE(result->channel == 37);
+
+    // Channels 32 to 39 are read together, the rest are never recorded
+    REQUIRE(*sources.reads == 40);
+}
+
+TEST_CASE("signal::find_first_parallel finds the signal and stops early"){
+    auto threads = GENERATE(1, 3, 8);
+
+    auto sources = make_sources(500, 1000);
+    sources.reader.group_size = 4;
+
+    scat::signal::scan_options options;
+    options.thread_count = threads;
+    options.pin = false;
+
+    auto result = scat::signal::find_first_parallel(sources.known, sources, options);
+
+    REQUIRE(result);
+    REQUIRE(result->channel == 500);
+    REQUIRE(*sources.reads < 1000);
+}
+
+TEST_CASE("signal::find_first_parallel reads every channel when there is no signal"){
+    auto sources = make_sources(1000, 100);
+
+    scat::signal::scan_options options;
+    options.thread_count = 4;
+    options.pin = false;
+
+    REQUIRE_FALSE(scat::signal::find_first_parallel(sources.known, sources, options));
+    REQUIRE(*sources.reads == 100);
+}
+
+TEST_CASE("signal::find_first_parallel gives every worker its own controller"){
+    auto sources = make_sources(1000, 100);
+
+    int controller = 0;
+    sources.reader.controller = &controller;
+
+    scat::signal::scan_options options;
+    options.thread_count = 4;
+    options.pin = false;
+
+    REQUIRE_FALSE(scat::signal::find_first_parallel(sources.known, sources, options));
+
+    // Workers that got to record at all did so with a copy
+    REQUIRE(!sources.controllers->seen.empty());
+    REQUIRE(sources.controllers->seen.size() <= 4);
+    REQUIRE(sources.controllers->seen.count(&controller) == 0);
+    REQUIRE(sources.reader.controller == &controller);
+}
+
+TEST_CASE("utils::spsc_ring keeps items in order across the wrap around"){
+    scat::utils::spsc_ring<int, 4> ring;
+
+    int output[4];
+    int next = 0;
+    int expected = 0;
+
+    for(size_t round = 0; round < 10; round += 1){
+        while(ring.try_push(next)){
+            next += 1;
+        }
+        REQUIRE(ring.size() == 4);
+
+        size_t count = ring.pop(output, 3);
+        REQUIRE(count == 3);
+        for(size_t i = 0; i < count; i += 1){
+            REQUIRE(output[i] == expected);
+            expected += 1;
+        }
+    }
+
+    REQUIRE(ring.pop(output, 4) == 1);
+    REQUIRE(output[0] == expected);
+    REQUIRE(ring.pop(output, 4) == 0);
+}
+
+TEST_CASE("utils::append_only_vector is readable while appending"){
+    static const size_t COUNT = 100000;
+
+    // Small chunks so that the reader crosses many chunk boundaries while they are allocated
+    scat::utils::append_only_vector<size_t, 16, COUNT / 16 + 1> items;
+    std::atomic<bool> mismatch{false};
+
+    std::thread reader([&]{
+        size_t checked = 0;
+        while(checked < COUNT){
+            size_t size = items.size();
+            for(; checked < size; checked += 1){
+                if(items[checked] != checked){
+                    mismatch.store(true);
+                }
+            }
+        }
+    });
+
+    for(size_t i = 0; i < COUNT; i += 1){
+        REQUIRE(items.push_back(i));
+    }
+    reader.join();
+
+    REQUIRE_FALSE(mismatch.load());
+    REQUIRE(items.size() == COUNT);
+
+    // Full once every chunk has been used
+    scat::utils::append_only_vector<size_t, 2, 2> full;
+    for(size_t i = 0; i < 4; i += 1){
+        REQUIRE(full.push_back(i));
+    }
+    REQUIRE_FALSE(full.push_back(4));
+    REQUIRE(full.size() == 4);
+}
+
+TEST_CASE("signal::run_length_encoder matches samples_to_lengths"){
+    auto gap = GENERATE(0, 1, 3, 6);
+
+    std::mt19937 g(gap);
+    std::vector<int16_t> samples;
+    for(size_t i = 0; i < 2000; i += 1){
+        samples.push_back((int16_t)(g() % 2));
+        if(g() % 4 == 0){
+            samples.insert(samples.end(), g() % 10, samples.back());
+        }
+    }
+
+    std::vector<scat::signal::length<int16_t>> lengths;
+    auto emit = [&](scat::signal::length<int16_t> const& length){
+        lengths.push_back(length);
+    };
+
+    scat::signal::run_length_encoder<int16_t> encoder(gap);
+    for(auto sample : samples){
+        encoder.push(sample, emit);
+    }
+    encoder.flush(emit);
+
+    auto expected = scat::signal::samples_to_lengths(samples, gap);
+    REQUIRE(lengths.size() == expected.size());
+    for(size_t i = 0; i < lengths.size(); i += 1){
+        REQUIRE(lengths[i].value == expected[i].value);
+        REQUIRE(lengths[i].length == expected[i].length);
+        REQUIRE(lengths[i].start == expected[i].start);
+    }
+}
+
+// Streams a fixed pattern of samples, then idles until stopped
+struct fake_source {
+    using sample_t = int16_t;
+
+    std::vector<int16_t> pattern;
+    std::shared_ptr<std::atomic<bool>> streamed = std::make_shared<std::atomic<bool>>(false);
+
+    template<class Sink>
+    void stream(std::atomic<bool> const& stop, Sink&& sink){
+        for(auto sample : pattern){
+            sink(sample);
+        }
+        streamed->store(true);
+
+        while(!stop.load()){
+            std::this_thread::yield();
+        }
+    }
+};
+
+TEST_CASE("signal::capture decodes runs while the probe thread records"){
+    using scat::signal::overrun_policy;
+    auto overrun = GENERATE(overrun_policy::drop, overrun_policy::block);
+
+    // 100 cycles of 20 samples high, one missed slot and 29 samples low
+    fake_source source;
+    for(size_t cycle = 0; cycle < 100; cycle += 1){
+        source.pattern.insert(source.pattern.end(), 20, 4);
+        source.pattern.push_back(-1);
+        source.pattern.insert(source.pattern.end(), 29, 0);
+    }
+
+    std::vector<scat::signal::length<int16_t>> runs;
+
+    scat::signal::capture_options options;
+    options.overrun = overrun;
+    options.pin = false;
+
+    // A ring much smaller than the recording, so the decoder has to keep up
+    scat::signal::capture<fake_source, 64> capture(source, [&](auto const& run){
+        runs.push_back(run);
+    }, options);
+
+    capture.start();
+    while(!source.streamed->load()){
+        std::this_thread::yield();
+    }
+    capture.stop();
+
+    auto& statistics = capture.get_statistics();
+    REQUIRE(statistics.recorded == 5000);
+    REQUIRE(statistics.decoded + statistics.dropped == 5000);
+    REQUIRE(statistics.high_water <= 64);
+    REQUIRE(statistics.runs == runs.size());
+
+    if(overrun == overrun_policy::block){
+        REQUIRE(statistics.dropped == 0);
+        REQUIRE(statistics.missed == 100);
+        REQUIRE(runs.size() == 200);
+
+        // The missed slot repeats the high value
+        REQUIRE(runs[0].value == 1);
+        REQUIRE(runs[0].length == 21);
+        REQUIRE(runs[1].value == 0);
+        REQUIRE(runs[1].length == 29);
+    }
+}
+
+// Records a fixed sequence of samples
+struct fake_reader {
+    std::vector<int16_t> samples;
+    size_t sample_count = 0;
+
+    template<class State, class Sink>
+    void record_channel(State&, channel_t, scat::chain_t&, Sink&& sink){
+        for(auto sample : samples){
+            sink(sample);
+        }
+    }
+};
+
+TEST_CASE("signal::record_runs and record_packed match thresholded samples"){
+    std::mt19937 g(7);
+
+    fake_reader reader;
+    for(size_t i = 0; i < 1000; i += 1){
+        int16_t sample = (int16_t)(g() % 4);
+        reader.samples.insert(reader.samples.end(), g() % 20 + 1, sample);
+        if(g() % 10 == 0){
+            reader.samples.push_back(-1);
+        }
+    }
+    reader.sample_count = reader.samples.size();
+
+    std::vector<int16_t> thresholded;
+    int16_t value = 0;
+    size_t missed = 0;
+    for(auto sample : reader.samples){
+        value = scat::signal::threshold_sample(sample, 2, value);
+        thresholded.push_back(value);
+        missed += (sample < 0) ? 1 : 0;
+    }
+
+    int state = 0;
+    scat::chain_t chain;
+
+    auto runs = scat::signal::record_runs(reader, state, 0, chain, 2);
+    REQUIRE(runs.size == reader.samples.size());
+    REQUIRE(runs.missed == missed);
+    REQUIRE(scat::signal::lengths_to_samples(runs.runs) == thresholded);
+
+    auto expected = scat::signal::samples_to_lengths(thresholded);
+    REQUIRE(runs.runs.size() == expected.size());
+    for(size_t i = 0; i < expected.size(); i += 1){
+        REQUIRE(runs.runs[i].start == expected[i].start);
+    }
+
+    // Short runs are merged as find_in_samples merges them
+    auto merged = scat::signal::record_runs(reader, state, 0, chain, 2, 6);
+    auto expected_merged = scat::signal::samples_to_lengths(thresholded, 6);
+    REQUIRE(merged.size == reader.samples.size());
+    REQUIRE(merged.runs.size() == expected_merged.size());
+    REQUIRE(merged.runs.size() < runs.runs.size());
+    for(size_t i = 0; i < expected_merged.size(); i += 1){
+        REQUIRE(merged.runs[i].value == expected_merged[i].value);
+        REQUIRE(merged.runs[i].length == expected_merged[i].length);
+        REQUIRE(merged.runs[i].start == expected_merged[i].start);
+    }
+
+    auto packed = scat::signal::record_packed(reader, state, 0, chain, 2);
+    REQUIRE(packed.size == reader.samples.size());
+    REQUIRE(packed.missed == missed);
+    REQUIRE(packed.words.size() == (packed.size + 63) / 64);
+    REQUIRE(packed.unpack() == thresholded);
+}
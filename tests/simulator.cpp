@@ -0,0 +1,912 @@
+#include <scat/prime_probe.hpp>
+#include <scat/profile.hpp>
+#include <scat/simulator.hpp>
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+
+using sim_cache_t = scat::simulator::cache<4>;
+using sim_timer_t = scat::simulator::timer;
+using evicter_t = scat::prime_probe::evicter<sim_cache_t, sim_timer_t>;
+using builder_t = scat::eviction_set_builder<evicter_t>;
+
+using scat::simulator::replacement_policy;
+
+// 2 slices * 128 sets * 4 ways * 64 bytes = 64KiB, with four times as many pages in the buffer
+scat::simulator::config small_config(replacement_policy policy){
+    scat::simulator::config config;
+    config.slices = 2;
+    config.sets_per_slice = 128;
+    config.policy = policy;
+    config.buffer_size = 256 * 1024;
+    return config;
+}
+
+// Returns elements that all map to the same location as the first element
+std::vector<sim_cache_t::element_t> congruent(sim_cache_t& cache, size_t count){
+    auto& elements = cache.get_elements();
+    auto location = cache.locate(elements[0]);
+
+    std::vector<sim_cache_t::element_t> result;
+    for(auto element : elements){
+        if(result.size() < count && cache.locate(element) == location){
+            result.push_back(element);
+        }
+    }
+    return result;
+}
+
+bool is_hit(sim_cache_t& cache, sim_cache_t::element_t element){
+    scat::chain_t chain;
+    sim_timer_t timer;
+
+    auto start = timer.get_ticks(chain);
+    cache.access_element(element, chain);
+    return (timer.get_ticks(chain) - start) < cache.get_config().miss_latency;
+}
+
+TEST_CASE("simulator lru evicts the least recently used line"){
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    scat::chain_t chain;
+
+    auto elements = congruent(cache, 5);
+    REQUIRE(elements.size() == 5);
+
+    for(size_t i = 0; i < 4; i += 1){
+        cache.access_element(elements[i], chain);
+    }
+    REQUIRE(is_hit(cache, elements[0]));
+
+    // elements[1] is now the least recently used
+    cache.access_element(elements[4], chain);
+    REQUIRE_FALSE(is_hit(cache, elements[1]));
+    REQUIRE(is_hit(cache, elements[0]));
+}
+
+TEST_CASE("simulator policies can not hold more lines than ways"){
+    auto policy = GENERATE(
+        replacement_policy::lru,
+        replacement_policy::tree_plru,
+        replacement_policy::qlru
+    );
+
+    sim_cache_t cache(small_config(policy));
+    scat::chain_t chain;
+
+    auto elements = congruent(cache, 5);
+    for(size_t i = 0; i < 4; i += 1){
+        cache.access_element(elements[i], chain);
+    }
+
+    // A set can hold every way
+    for(size_t i = 0; i < 4; i += 1){
+        REQUIRE(is_hit(cache, elements[i]));
+    }
+
+    cache.access_element(elements[4], chain);
+
+    size_t hits = 0;
+    for(size_t i = 0; i < 4; i += 1){
+        hits += is_hit(cache, elements[i]) ? 1 : 0;
+    }
+    REQUIRE(hits < 4);
+}
+
+TEST_CASE("simulator flush_element evicts a line"){
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    scat::chain_t chain;
+
+    auto element = cache.get_elements()[0];
+    cache.access_element(element, chain);
+    REQUIRE(is_hit(cache, element));
+
+    cache.flush_element(element);
+    REQUIRE_FALSE(is_hit(cache, element));
+}
+
+TEST_CASE("eviction_set_builder constructs congruent sets on the simulator"){
+    auto policy = GENERATE(
+        replacement_policy::lru,
+        replacement_policy::tree_plru,
+        replacement_policy::qlru
+    );
+    auto expand = GENERATE(scat::expand_strategy::linear, scat::expand_strategy::doubling);
+    auto contract = GENERATE(
+        scat::contract_strategy::linear,
+        scat::contract_strategy::group_testing
+    );
+
+    sim_cache_t cache(small_config(policy));
+    sim_timer_t timer;
+    scat::chain_t chain;
+    evicter_t evicter(&cache, &timer, chain);
+
+    scat::eviction_set_options options;
+    options.expand = expand;
+    options.contract = contract;
+    options.seed = 1;
+
+    auto candidates = cache.get_elements();
+    auto sets = builder_t::build_base(evicter, candidates, options);
+
+    // 2 slices * 128 sets / 64 cachelines per page = 4 classes of page aligned elements
+    REQUIRE(sets.size() >= 3);
+    REQUIRE(sets.size() <= 4);
+
+    std::set<std::pair<size_t, size_t>> locations;
+    for(auto& set : sets){
+        auto location = cache.locate(set.witness);
+        locations.insert({location.slice, location.set});
+
+        size_t matching = 0;
+        for(auto element : set.elements){
+            matching += (cache.locate(element) == location) ? 1 : 0;
+        }
+        REQUIRE(matching >= 4);
+    }
+
+    // Every set covers a different location
+    REQUIRE(locations.size() == sets.size());
+}
+
+TEST_CASE("eviction_set_builder is reproducible on the simulator"){
+    auto build = []{
+        sim_cache_t cache(small_config(replacement_policy::lru));
+        sim_timer_t timer;
+        scat::chain_t chain;
+        evicter_t evicter(&cache, &timer, chain);
+
+        scat::eviction_set_options options;
+        options.seed = 42;
+
+        return builder_t::build(evicter, options);
+    };
+
+    REQUIRE(build() == build());
+}
+
+TEST_CASE("eviction_set_builder::build_for_element finds a set for the target"){
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    sim_timer_t timer;
+    scat::chain_t chain;
+    evicter_t evicter(&cache, &timer, chain);
+
+    scat::build_statistics statistics;
+
+    scat::eviction_set_options options;
+    options.seed = 3;
+    options.statistics = &statistics;
+
+    // Target an element in the middle of a page
+    auto target = cache.get_elements()[5] + 7 * sim_cache_t::LINE_SIZE;
+    auto sets = builder_t::build_for_element(evicter, target, options);
+
+    REQUIRE(sets.size() == 1);
+    REQUIRE(evicter.set_evicts(sets[0], target, chain));
+
+    REQUIRE(statistics.get_set_count() == 1);
+    REQUIRE(statistics.successes == 1);
+    REQUIRE(statistics.attempts ==
+        statistics.successes + statistics.expand_failures + statistics.contract_failures
+    );
+    REQUIRE(statistics.expand.calls > 0);
+    REQUIRE(statistics.contract.calls > 0);
+}
+
+TEST_CASE("eviction_set_builder collects build_statistics"){
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    sim_timer_t timer;
+    scat::chain_t chain;
+    evicter_t evicter(&cache, &timer, chain);
+
+    scat::build_statistics statistics;
+
+    scat::eviction_set_options options;
+    options.seed = 5;
+    options.statistics = &statistics;
+
+    auto candidates = cache.get_elements();
+    auto sets = builder_t::build_base(evicter, candidates, options);
+
+    REQUIRE(statistics.get_set_count() == sets.size());
+    REQUIRE(statistics.successes == sets.size());
+    REQUIRE(statistics.attempts ==
+        statistics.successes + statistics.expand_failures +
+        statistics.contract_failures + statistics.duplicates
+    );
+
+    REQUIRE(statistics.expand.calls > 0);
+    REQUIRE(statistics.contract.calls > 0);
+    REQUIRE(statistics.collect.batch_calls > 0);
+
+    REQUIRE(statistics.get_time_to_sets(1) >= 0);
+    REQUIRE(statistics.get_time_to_sets(sets.size() + 1) < 0);
+}
+
+TEST_CASE("evicter::autotune picks a strategy that evicts"){
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    sim_timer_t timer;
+    scat::chain_t chain;
+    evicter_t evicter(&cache, &timer, chain);
+
+    scat::eviction_set_options options;
+    options.seed = 9;
+    options.autotune = true;
+
+    // Tuning happens part way through construction, which must still find every set
+    auto candidates = cache.get_elements();
+    auto sets = builder_t::build_base(evicter, candidates, options);
+    REQUIRE(sets.size() >= 3);
+
+    auto tuning = evicter.autotune(sets, chain);
+    REQUIRE(tuning.rate == 1.0);
+
+    auto probe = evicter.autotune_probe(sets, chain);
+    REQUIRE(probe.rate == 1.0);
+}
+
+TEST_CASE("evicter calibrates a threshold on a noisy cache"){
+    auto config = small_config(replacement_policy::lru);
+    config.jitter = 60;
+    config.interference = 0.01;
+
+    sim_cache_t cache(config);
+    sim_timer_t timer;
+    scat::chain_t chain;
+    evicter_t evicter(&cache, &timer, chain);
+
+    auto& calibration = evicter.calibration;
+
+    // Hits take 40 to 100 ticks and misses 200 to 260, plus the cost of reading the timer
+    REQUIRE(evicter.threshold > config.hit_latency + config.jitter);
+    REQUIRE(evicter.threshold <= config.miss_latency + config.timer_latency);
+    REQUIRE(calibration.error_rate < 0.05);
+    REQUIRE(calibration.separation > 0.8);
+
+    // The threshold settles long before every sample is taken
+    REQUIRE(calibration.stable);
+    REQUIRE(calibration.samples < evicter.calibration_samples);
+}
+
+TEST_CASE("reader_eviction_count recenters an adaptive threshold"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_eviction_count<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+
+    // Twice as many congruent elements as ways, most accesses of a probe miss
+    state.sets.push_back(congruent(*state.backend, 8));
+    REQUIRE(state.sets[0].size() == 8);
+
+    scat::chain_t chain;
+    auto config = state.backend->get_config();
+
+    reader_t reader;
+    reader.sample_count = 200;
+    reader.sample_length = 8000;
+    reader.adaptive = true;
+    reader.tracking_interval = 256;
+
+    // Far above any latency, nothing is counted as evicted
+    reader.threshold = 10000;
+
+    auto samples = reader.read_channel(state, 0, chain);
+
+    REQUIRE_FALSE(reader.threshold_events.empty());
+    REQUIRE(reader.threshold_events.front().previous == 10000);
+    REQUIRE(reader.threshold_events.front().applied);
+
+    auto threshold = reader.get_threshold();
+    REQUIRE(threshold > config.hit_latency + config.timer_latency);
+    REQUIRE(threshold <= config.miss_latency + config.timer_latency);
+
+    // Once recentered, evictions are counted again
+    REQUIRE(samples.back() > 0);
+}
+
+TEST_CASE("reader_eviction_count recenters with a slot_controller"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_eviction_count<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+    state.sets.push_back(congruent(*state.backend, 8));
+
+    scat::chain_t chain;
+    auto config = state.backend->get_config();
+
+    scat::prime_probe::slot_controller controller;
+    controller.window = 64;
+
+    // The controller shrinks sample_length towards the busy time, recalibrations must still fit
+    reader_t reader;
+    reader.sample_count = 4000;
+    reader.adaptive = true;
+    reader.tracking_interval = 256;
+    reader.threshold = 10000;
+    reader.threshold_event_capacity = 4;
+    reader.controller = &controller;
+
+    auto samples = reader.read_channel(state, 0, chain);
+
+    // 4000 probes of 8 latencies recalibrate far more often than the capacity
+    REQUIRE(reader.threshold_events.size() == 4);
+    REQUIRE(reader.threshold_events.back().latencies > 4 * reader.tracking_interval);
+    REQUIRE(reader.threshold_events.back().applied);
+
+    auto threshold = reader.get_threshold();
+    REQUIRE(threshold > config.hit_latency + config.timer_latency);
+    REQUIRE(threshold <= config.miss_latency + config.timer_latency);
+
+    REQUIRE(controller.get(0).get_miss_rate() < 0.05);
+    REQUIRE(samples.back() > 0);
+}
+
+TEST_CASE("reader_interleaved records a group of channels at once"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_interleaved<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+
+    auto& cache = *state.backend;
+    auto noisy = congruent(cache, 8);
+
+    // Ways elements at another location, which are never evicted once cached
+    std::vector<sim_cache_t::element_t> quiet;
+    for(auto element : cache.get_elements()){
+        if(!(cache.locate(element) == cache.locate(noisy[0]))){
+            if(quiet.empty() || cache.locate(element) == cache.locate(quiet[0])){
+                quiet.push_back(element);
+            }
+        }
+        if(quiet.size() == 4){
+            break;
+        }
+    }
+
+    state.sets.push_back(noisy);
+    state.sets.push_back(quiet);
+
+    scat::chain_t chain;
+    auto config = cache.get_config();
+
+    reader_t reader;
+    reader.group_size = 2;
+    reader.sample_count = 100;
+    reader.sample_length = 4000;
+    reader.threshold = config.miss_latency;
+
+    std::vector<scat::prime_probe::channel_t> channels = {0, 1};
+
+    auto start = scat::simulator::clock::ticks;
+    auto samples = reader.read_channels(state, channels, chain);
+    auto elapsed = scat::simulator::clock::ticks - start;
+
+    REQUIRE(samples.size() == 2);
+    REQUIRE(samples[0].size() == 100);
+    REQUIRE(samples[1].size() == 100);
+
+    // Both channels share one recording, in slots of twice sample_length
+    REQUIRE(elapsed < 101 * 2 * reader.sample_length);
+    REQUIRE(reader.sample_length == 4000);
+
+    for(size_t i = 1; i < 100; i += 1){
+        REQUIRE(samples[0][i] >= 4);
+        REQUIRE(samples[1][i] == 0);
+    }
+}
+
+TEST_CASE("reader_interleaved fits a group into slots with the default sample_length"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_interleaved<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+
+    // Sets that miss on every access, one alone fits the default slot but not a group of them
+    auto noisy = congruent(*state.backend, 8);
+    reader_t reader;
+    for(size_t i = 0; i < reader.get_group_size(); i += 1){
+        state.sets.push_back(noisy);
+    }
+
+    scat::chain_t chain;
+    reader.threshold = state.backend->get_config().miss_latency;
+
+    std::vector<scat::prime_probe::channel_t> channels = {0, 1, 2, 3};
+    auto samples = reader.read_channels(state, channels, chain);
+
+    REQUIRE(samples.size() == 4);
+    for(auto& channel : samples){
+        REQUIRE(channel.size() == reader.sample_count);
+
+        auto missed = std::count(channel.begin(), channel.end(), reader_t::MISSED_TIME_SLOT);
+        REQUIRE(missed <= 1);
+    }
+}
+
+TEST_CASE("reader_interleaved paces groups with a slot_controller"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_interleaved<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+
+    auto noisy = congruent(*state.backend, 8);
+    for(size_t i = 0; i < 4; i += 1){
+        state.sets.push_back(noisy);
+    }
+
+    scat::chain_t chain;
+    scat::prime_probe::slot_controller controller;
+    controller.window = 64;
+
+    reader_t reader;
+    reader.group_size = 4;
+    reader.sample_count = 2000;
+    reader.threshold = state.backend->get_config().miss_latency;
+
+    // Calibrated on channel 0 alone, the length only fits a single set
+    auto single = controller.calibrate(reader, state, 0, chain);
+
+    std::vector<scat::prime_probe::channel_t> channels = {0, 1, 2, 3};
+    auto samples = reader.read_channels(state, channels, chain);
+
+    // The group's slot starts at four of the channel's lengths. Four copies of a set evict more of
+    // each other than one alone, so the controller grows it over the first windows and then
+    // hardly misses.
+    for(auto& channel : samples){
+        auto missed = std::count(channel.begin() + 1000, channel.end(), reader_t::MISSED_TIME_SLOT);
+        REQUIRE(missed < 20);
+    }
+
+    // The controller keeps a per channel length, and the reader is left on it
+    auto length = controller.get(0).length;
+    REQUIRE(length < 2 * single);
+    REQUIRE(reader.sample_length == length);
+
+    // Channel 0 alone still fits the length the group left behind
+    auto alone = reader.read_channel(state, 0, chain);
+    auto missed = std::count(alone.begin(), alone.end(), reader_t::MISSED_TIME_SLOT);
+    REQUIRE(missed < 100);
+}
+
+TEST_CASE("slot_controller finds the shortest sustainable sample_length"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_eviction_count<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+    state.sets.push_back(congruent(*state.backend, 8));
+
+    auto config = state.backend->get_config();
+    scat::chain_t chain;
+
+    scat::prime_probe::slot_controller controller;
+    controller.window = 64;
+
+    reader_t reader;
+    reader.threshold = config.miss_latency;
+    reader.sample_count = 1000;
+
+    // Every element of a probe takes at least a hit and a timer read
+    auto minimum = 8 * (config.hit_latency + 2 * config.timer_latency);
+
+    SECTION("calibrate shrinks from the maximum"){
+        auto length = controller.calibrate(reader, state, 0, chain);
+        REQUIRE(length > minimum);
+        REQUIRE(length < controller.maximum_length / 4);
+        REQUIRE(reader.sample_length == length);
+        REQUIRE(reader.controller == &controller);
+        REQUIRE(controller.get(0).length == length);
+    }
+
+    SECTION("calibrate validates the length it settles on"){
+        // Headroom below the busy time settles on a length that misses most slots
+        controller.headroom = 0.5;
+        auto length = controller.calibrate(reader, state, 0, chain);
+
+        reader.controller = nullptr;
+        auto samples = reader.read_channel(state, 0, chain);
+        auto missed = std::count(samples.begin(), samples.end(), reader_t::MISSED_TIME_SLOT);
+        REQUIRE(missed <= 10);
+        REQUIRE(reader.sample_length == length);
+    }
+
+    SECTION("recording grows a sample_length that misses slots"){
+        reader.controller = &controller;
+        reader.sample_length = 100;
+
+        reader.read_channel(state, 0, chain);
+        REQUIRE(controller.get(0).adjustments > 0);
+        REQUIRE(reader.sample_length > minimum);
+    }
+
+    // Once settled, a recording without the controller hardly misses any slots
+    controller.calibrate(reader, state, 0, chain);
+    reader.controller = nullptr;
+
+    auto samples = reader.read_channel(state, 0, chain);
+    auto missed = std::count(samples.begin(), samples.end(), reader_t::MISSED_TIME_SLOT);
+    REQUIRE(missed <= 10);
+}
+
+TEST_CASE("reader_aggregate estimates evictions from the traversal time"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_aggregate<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+    state.sets.push_back(congruent(*state.backend, 4));
+    REQUIRE(state.sets[0].size() == 4);
+
+    auto& cache = *state.backend;
+    auto config = cache.get_config();
+    scat::chain_t chain;
+
+    reader_t reader;
+    reader.calibrate(state, 0, chain);
+
+    // One more miss per count, a hit costs hit_latency
+    REQUIRE(reader.latency_table.size() == 5);
+    for(size_t k = 1; k < 5; k += 1){
+        auto step = reader.latency_table[k] - reader.latency_table[k - 1];
+        REQUIRE(step >= config.miss_latency - config.hit_latency - 1);
+    }
+
+    // Flushing k elements between probes is estimated as k evictions
+    auto set = state.sets[0].to_vector();
+    for(size_t k = 0; k <= 4; k += 1){
+        reader.sample_count = 1;
+        reader.read_channel(state, 0, chain);
+
+        for(size_t i = 0; i < k; i += 1){
+            cache.flush_element(set[i]);
+        }
+
+        auto samples = reader.read_channel(state, 0, chain);
+        REQUIRE(samples[0] == (int16_t)k);
+    }
+}
+
+TEST_CASE("reader_unrolled picks a kernel from the set size"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_unrolled<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+    state.sets.push_back(congruent(*state.backend, 4));
+    REQUIRE(state.sets[0].size() == 4);
+
+    auto& cache = *state.backend;
+    auto set = state.sets[0].to_vector();
+    scat::chain_t chain;
+
+    auto mode = GENERATE(
+        scat::prime_probe::timing_mode::element,
+        scat::prime_probe::timing_mode::aggregate
+    );
+
+    reader_t reader;
+    reader.timing = mode;
+    reader.prepare(state, chain);
+    REQUIRE(reader.kernel_size == 4);
+    REQUIRE(reader.kernel_channels == 1);
+
+    // Flushing k elements between probes counts k evictions, as with the generic readers
+    for(size_t k = 0; k <= 4; k += 1){
+        reader.sample_count = 1;
+        reader.read_channel(state, 0, chain);
+
+        for(size_t i = 0; i < k; i += 1){
+            cache.flush_element(set[i]);
+        }
+
+        auto samples = reader.read_channel(state, 0, chain);
+        REQUIRE(samples[0] == (int16_t)k);
+    }
+
+    // There is no kernel for three elements, the generic reader is used instead
+    set.pop_back();
+    state.sets = {set};
+    reader.prepare(state, chain);
+    REQUIRE(reader.kernel_size == 0);
+
+    reader.sample_count = 1;
+    reader.read_channel(state, 0, chain);
+    cache.flush_element(set[0]);
+    REQUIRE(reader.read_channel(state, 0, chain)[0] == 1);
+    REQUIRE(reader.kernel_channels == 0);
+
+    // The kernel follows the size most channels share, not the first channel's
+    auto eight = congruent(cache, 8);
+    state.sets = {set, eight, {eight.begin(), eight.begin() + 4}, {eight.begin() + 4, eight.end()}};
+    reader.prepare(state, chain);
+    REQUIRE(reader.kernel_size == 4);
+    REQUIRE(reader.kernel_channels == 2);
+}
+
+TEST_CASE("set_arena keeps sets clear of their own cache line"){
+    using arena_t = scat::prime_probe::set_arena<sim_cache_t::element_t>;
+
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    auto& elements = cache.get_elements();
+
+    // One set per line of the page, like extend_elements, plus a set longer than a line
+    std::vector<std::vector<sim_cache_t::element_t>> sets;
+    for(auto& set : cache.extend_elements({elements.begin(), elements.begin() + 12})){
+        sets.push_back(set);
+    }
+    sets.push_back({elements.begin(), elements.begin() + 20});
+
+    arena_t arena(sets);
+    REQUIRE(arena.size() == sets.size());
+
+    for(size_t channel = 0; channel < sets.size(); channel += 1){
+        auto view = arena[channel];
+        REQUIRE(view.to_vector() == sets[channel]);
+        REQUIRE(std::vector<sim_cache_t::element_t>(view.rbegin(), view.rend()) ==
+            std::vector<sim_cache_t::element_t>(sets[channel].rbegin(), sets[channel].rend()));
+
+        // None of the lines holding the offsets share a line of the page with the set
+        auto line = scat::prime_probe::element_line(sets[channel][0]);
+        for(size_t i = 0; i < view.size(); i += arena_t::SET_LINE_CAPACITY){
+            REQUIRE(scat::prime_probe::element_line(view.data() + i) != line);
+        }
+    }
+
+    // Sets of up to a line in line order are placed without gaps
+    REQUIRE(arena.get_memory_usage() <= 4096 * 2 + sets.size() * 16);
+}
+
+TEST_CASE("set_arena starts from the first non-empty set"){
+    using arena_t = scat::prime_probe::set_arena<sim_cache_t::element_t>;
+
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    auto& elements = cache.get_elements();
+
+    // Offsets of later sets are relative to the first element added, not to an empty first set
+    std::vector<std::vector<sim_cache_t::element_t>> sets = {
+        {},
+        {elements[3], elements[1], elements[2]},
+        {},
+        {elements[0], elements[4]}
+    };
+
+    arena_t arena(sets);
+    REQUIRE(arena.size() == 4);
+    for(size_t channel = 0; channel < sets.size(); channel += 1){
+        REQUIRE(arena[channel].to_vector() == sets[channel]);
+    }
+
+    // The iterators are random access
+    auto view = arena[1];
+    auto begin = view.begin();
+    auto end = view.end();
+
+    REQUIRE(end - begin == 3);
+    REQUIRE(*(2 + begin) == elements[2]);
+    REQUIRE(2 + begin == begin + 2);
+    REQUIRE(begin < end);
+    REQUIRE(end > begin);
+    REQUIRE(begin <= begin);
+    REQUIRE(end >= begin);
+    REQUIRE_FALSE(begin >= end);
+    REQUIRE(*std::max_element(begin, end) == elements[3]);
+}
+
+TEST_CASE("subtract_timer_overhead leaves samples unchanged"){
+    using state_t = scat::prime_probe::state<sim_cache_t, sim_timer_t, evicter_t>;
+    using reader_t = scat::prime_probe::reader_unrolled<state_t>;
+
+    state_t state;
+    state.backend = std::make_unique<sim_cache_t>(small_config(replacement_policy::lru));
+    state.timer = std::make_unique<sim_timer_t>();
+    state.sets.push_back(congruent(*state.backend, 4));
+
+    auto& cache = *state.backend;
+    auto set = state.sets[0].to_vector();
+    scat::chain_t chain;
+
+    reader_t reader;
+    reader.threshold = 130;
+    reader.subtract_timer_overhead(10);
+    reader.subtract_timer_overhead(sim_timer_t::latency);
+    REQUIRE(reader.threshold == 130 - sim_timer_t::latency);
+
+    // Both the unrolled kernel and the generic reader
+    for(auto adaptive : {false, true}){
+        reader.adaptive = adaptive;
+        reader.prepare(state, chain);
+
+        reader.sample_count = 1;
+        reader.read_channel(state, 0, chain);
+        cache.flush_element(set[0]);
+        cache.flush_element(set[1]);
+        REQUIRE(reader.read_channel(state, 0, chain)[0] == 2);
+    }
+}
+
+TEST_CASE("eviction_set_registry publishes every entry once"){
+    scat::eviction_set_registry<uint64_t> registry;
+    REQUIRE(registry.get_head() == nullptr);
+
+    static const size_t THREADS = 4;
+    static const size_t PUSHES = 1000;
+
+    std::vector<std::thread> threads;
+    for(size_t owner = 0; owner < THREADS; owner += 1){
+        threads.emplace_back([&registry, owner]{
+            for(uint64_t i = 0; i < PUSHES; i += 1){
+                registry.push({i}, owner * PUSHES + i, owner);
+            }
+        });
+    }
+    for(auto& thread : threads){
+        thread.join();
+    }
+
+    // Every push is reachable exactly once, and each owner's entries are in reverse push order
+    std::set<uint64_t> witnesses;
+    std::vector<uint64_t> last(THREADS, PUSHES);
+    for(auto entry = registry.get_head(); entry != nullptr; entry = entry->next){
+        REQUIRE(witnesses.insert(entry->witness).second);
+        REQUIRE(entry->set[0] < last[entry->owner]);
+        last[entry->owner] = entry->set[0];
+    }
+    REQUIRE(witnesses.size() == THREADS * PUSHES);
+}
+
+TEST_CASE("eviction_set_builder builds congruent sets with several threads"){
+    // A buffer 16 times the cache, so that every worker's partition can build sets on its own
+    auto config = small_config(replacement_policy::lru);
+    config.buffer_size = 1024 * 1024;
+
+    sim_cache_t cache(config);
+    sim_timer_t timer;
+    scat::chain_t chain;
+    evicter_t evicter(&cache, &timer, chain);
+
+    scat::eviction_set_options options;
+    options.thread_count = 4;
+    options.seed = 3;
+
+    auto candidates = cache.get_elements();
+    auto sets = builder_t::build_base(evicter, candidates, options);
+
+    REQUIRE(sets.size() >= 3);
+    REQUIRE(sets.size() <= 4);
+
+    // No two workers returned a set for the same location
+    std::set<std::pair<size_t, size_t>> locations;
+    for(auto& set : sets){
+        auto location = cache.locate(set.witness);
+        REQUIRE(locations.insert({location.slice, location.set}).second);
+
+        size_t matching = 0;
+        for(auto element : set.elements){
+            matching += (cache.locate(element) == location) ? 1 : 0;
+        }
+        REQUIRE(matching >= 4);
+    }
+}
+
+TEST_CASE("profile round trips through a file"){
+    using profile_t = scat::prime_probe::profile<sim_cache_t, sim_timer_t>;
+
+    std::string path = "scat-test-profile";
+    sim_cache_t cache(small_config(replacement_policy::lru));
+
+    profile_t saved;
+    saved.threshold = 123;
+    saved.realtime.ratio = 0.5;
+    saved.realtime.realtime = std::chrono::nanoseconds(1000);
+    saved.realtime.ticks = 2000;
+
+    auto& elements = cache.get_elements();
+    saved.sets.push_back({{elements[1], elements[2], elements[3]}, elements[4]});
+    saved.sets.push_back({{elements[5] + 64, elements[6] + 64}, elements[7] + 64});
+    REQUIRE(saved.save(path, cache));
+
+    // Saving replaces the file rather than leaving a temporary behind
+    REQUIRE(!std::ifstream(path + ".tmp"));
+
+    profile_t loaded;
+    REQUIRE(loaded.load(path, cache));
+    REQUIRE(loaded.threshold == saved.threshold);
+    REQUIRE(loaded.realtime.ratio == saved.realtime.ratio);
+    REQUIRE(loaded.realtime.realtime == saved.realtime.realtime);
+    REQUIRE(loaded.realtime.ticks == saved.realtime.ticks);
+    REQUIRE(loaded.sets.size() == saved.sets.size());
+    for(size_t i = 0; i < saved.sets.size(); i += 1){
+        REQUIRE(loaded.sets[i].witness == saved.sets[i].witness);
+        REQUIRE(loaded.sets[i].elements == saved.sets[i].elements);
+    }
+
+    // A different buffer size changes the host key
+    auto other_config = small_config(replacement_policy::lru);
+    other_config.buffer_size *= 2;
+    sim_cache_t other(other_config);
+
+    profile_t mismatched;
+    REQUIRE(!mismatched.load(path, other));
+    REQUIRE(mismatched.sets.empty());
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("eviction_set_builder stops when cancelled"){
+    sim_cache_t cache(small_config(replacement_policy::lru));
+    sim_timer_t timer;
+    scat::chain_t chain;
+    evicter_t evicter(&cache, &timer, chain);
+
+    std::atomic<bool> cancel{false};
+    scat::eviction_set_options options;
+    options.seed = 3;
+    options.cancel = &cancel;
+
+    // Cancel from within construction, after the first set
+    size_t published = 0;
+    auto candidates = cache.get_elements();
+    auto sets = builder_t::build_base(evicter, candidates, options, [&](auto const&){
+        published += 1;
+        cancel.store(true);
+    });
+
+    REQUIRE(published == 1);
+    REQUIRE(sets.size() == 1);
+}
+
+TEST_CASE("streaming_state publishes sets to waiting readers"){
+    using state_t = scat::prime_probe::streaming_state<sim_cache_t, sim_timer_t, evicter_t>;
+    state_t state;
+
+    std::thread builder([&]{
+        for(sim_cache_t::element_t i = 0; i < 3; i += 1){
+            state.publish({i});
+        }
+        state.finish();
+    });
+
+    REQUIRE(state.wait_for_channel(2));
+    REQUIRE(state.sets[2][0] == 2);
+    REQUIRE_FALSE(state.wait_for_channel(3));
+    builder.join();
+
+    // finish also releases anyone waiting for tuning
+    state.wait_for_tuning();
+}
+
+TEST_CASE("create_streaming tunes the probe strategy and cancels construction"){
+    scat::eviction_set_options options;
+    options.seed = 3;
+    options.autotune = true;
+
+    auto group = scat::prime_probe::create_streaming<sim_cache_t, sim_timer_t, evicter_t>(options);
+
+    // Readers are only handed out after tuning, which happens on the builder thread
+    auto channels = group.get_channels();
+    auto channel = channels.begin();
+    REQUIRE(channel != channels.end());
+    REQUIRE(*channel == 0);
+    REQUIRE(group.reader.strategy.repetitions <= 3);
+
+    group.reader.sample_count = 100;
+    auto samples = group.read_channel(*channel);
+    REQUIRE(!samples.empty());
+
+    // Destroying the group cancels the construction of the remaining sets
+}
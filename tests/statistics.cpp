@@ -0,0 +1,157 @@
+#include <scat/statistics.hpp>
+#include <scat/utils.hpp>
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+TEST_CASE("statistics::select matches utils::sample"){
+    std::mt19937 g(1);
+    std::uniform_int_distribution<int> value(0, 1000);
+
+    // Sizes on either side of the sorting network limit
+    for(size_t size = 1; size <= 40; size += 1){
+        for(float percentile : {0.0f, 0.2f, 0.5f, 0.8f, 1.0f}){
+            std::vector<int> values(size);
+            for(auto& v : values){
+                v = value(g);
+            }
+
+            auto sorted = values;
+            std::sort(sorted.begin(), sorted.end());
+
+            auto selected = scat::statistics::select(percentile, values.begin(), values.end());
+            REQUIRE(selected == scat::utils::sample(percentile, sorted));
+        }
+    }
+}
+
+TEST_CASE("statistics::sorting_network sorts"){
+    std::mt19937 g(2);
+
+    for(size_t size = 0; size <= scat::statistics::SORTING_NETWORK_LIMIT; size += 1){
+        std::vector<uint32_t> values(size);
+        for(auto& v : values){
+            v = g();
+        }
+
+        scat::statistics::sorting_network(values.begin(), size);
+        REQUIRE(std::is_sorted(values.begin(), values.end()));
+    }
+}
+
+TEST_CASE("statistics::sample_buffer drops samples once full"){
+    scat::statistics::sample_buffer<int, 4> buffer;
+
+    for(int i = 10; i > 0; i -= 1){
+        buffer.push(i);
+    }
+
+    REQUIRE(buffer.full());
+    REQUIRE(buffer.size() == 4);
+    REQUIRE(buffer.select(0.0) == 7);
+    REQUIRE(buffer.select(1.0) == 10);
+}
+
+TEST_CASE("statistics::sample caps the count at the capacity"){
+    int calls = 0;
+    auto median = scat::statistics::sample<8>(0.5, 100, [&]{
+        calls += 1;
+        return calls;
+    });
+
+    REQUIRE(calls == 8);
+    REQUIRE(median == 5);
+}
+
+TEST_CASE("statistics::select and sample return zero for no samples"){
+    std::vector<int> empty;
+    REQUIRE(scat::statistics::select(0.5, empty.begin(), empty.end()) == 0);
+
+    scat::statistics::sample_buffer<uint64_t, 4> buffer;
+    REQUIRE(buffer.select(0.5) == 0);
+
+    int calls = 0;
+    auto median = scat::statistics::sample<8>(0.5, 0, [&]{
+        calls += 1;
+        return calls;
+    });
+
+    REQUIRE(calls == 0);
+    REQUIRE(median == 0);
+}
+
+TEST_CASE("statistics::p2_quantile estimates percentiles of a stream"){
+    auto percentile = GENERATE(0.1, 0.5, 0.9);
+
+    std::mt19937 g(3);
+    std::normal_distribution<double> value(100, 10);
+
+    scat::statistics::p2_quantile estimator(percentile);
+    std::vector<double> values;
+
+    for(size_t i = 0; i < 20000; i += 1){
+        auto v = value(g);
+        estimator.add(v);
+        values.push_back(v);
+    }
+
+    std::sort(values.begin(), values.end());
+    auto exact = scat::utils::sample((float)percentile, values);
+
+    REQUIRE(estimator.size() == values.size());
+    REQUIRE(estimator.get() == Approx(exact).margin(1.0));
+}
+
+TEST_CASE("statistics::p2_quantile is exact for the first samples"){
+    scat::statistics::p2_quantile estimator(0.3);
+
+    estimator.add(3);
+    estimator.add(1);
+    estimator.add(2);
+
+    REQUIRE(estimator.get() == 2);
+}
+
+TEST_CASE("statistics::histogram::otsu splits two modes"){
+    std::mt19937 g(4);
+    std::normal_distribution<double> hit(60, 8);
+    std::normal_distribution<double> miss(240, 20);
+
+    scat::statistics::histogram<128> values(4);
+    for(size_t i = 0; i < 500; i += 1){
+        values.add((uint64_t)std::max(hit(g), 0.0));
+        values.add((uint64_t)std::max(miss(g), 0.0));
+    }
+
+    auto split = values.otsu();
+    REQUIRE(split.threshold > 76);
+    REQUIRE(split.threshold < 180);
+    REQUIRE(split.separation > 0.9);
+
+    REQUIRE(values.count_below(split.threshold) == Approx(500).margin(5));
+}
+
+TEST_CASE("statistics::histogram counts large values in the last bin"){
+    scat::statistics::histogram<4> values(10);
+
+    values.add(5);
+    values.add(1000);
+
+    REQUIRE(values.size() == 2);
+    REQUIRE(values.count_below(30) == 1);
+    REQUIRE(values.count_below(40) == 2);
+}
+
+TEST_CASE("statistics::histogram::decay halves every count"){
+    scat::statistics::histogram<4> values(10);
+
+    for(size_t i = 0; i < 5; i += 1){
+        values.add(5);
+    }
+    values.add(25);
+    values.decay();
+
+    REQUIRE(values.size() == 2);
+    REQUIRE(values.count_below(10) == 2);
+}
@@ -0,0 +1,99 @@
+#include <scat/simulator.hpp>
+#include <scat/timer.hpp>
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+template<class Timer>
+void check_timer(){
+    using calibration_t = scat::timer::realtime_calibration<Timer>;
+
+    Timer timer;
+    scat::chain_t chain;
+
+    // Never runs backwards (32 bit timers could wrap, but not within a few reads)
+    auto previous = timer.get_ticks(chain);
+    for(size_t i = 0; i < 1000; i += 1){
+        auto ticks = timer.get_ticks(chain);
+        REQUIRE(ticks >= previous);
+        previous = ticks;
+    }
+
+    auto settings = calibration_t::calibrate(
+        timer, std::chrono::microseconds(200), 0.5, 3, chain
+    );
+    REQUIRE(settings.ticks > 0);
+    REQUIRE(settings.ratio > 0);
+
+    // Round trips through realtime
+    auto ticks = scat::timer::realtime_to_ticks<Timer>(std::chrono::microseconds(100));
+    REQUIRE(ticks > 0);
+    REQUIRE(scat::timer::ticks_to_realtime<Timer>(ticks) > std::chrono::microseconds(50));
+}
+
+TEST_CASE("fenced rdtsc timers calibrate against realtime"){
+    check_timer<scat::timer::lfence_rdtsc64>();
+    check_timer<scat::timer::mfence_rdtsc64>();
+}
+
+TEST_CASE("monotonic_raw calibrates against realtime"){
+    check_timer<scat::timer::monotonic_raw>();
+}
+
+TEST_CASE("counting_thread calibrates against realtime"){
+    check_timer<scat::timer::counting_thread>();
+}
+
+TEST_CASE("counting_thread shares one counter between timers"){
+    scat::chain_t chain;
+    scat::timer::counting_thread first;
+    scat::timer::counting_thread second(first);
+
+    auto start = first.get_ticks(chain);
+    while(second.get_ticks(chain) == start){
+        std::this_thread::yield();
+    }
+    REQUIRE(second.get_ticks(chain) > start);
+}
+
+TEST_CASE("characterize measures the cost of a timer read"){
+    auto result = scat::timer::characterize<scat::simulator::timer>(1000);
+
+    // Every read of the simulated timer costs exactly timer_latency ticks
+    auto latency = scat::simulator::timer::latency;
+    REQUIRE(result.samples == 1000);
+    REQUIRE(result.overhead_minimum == latency);
+    REQUIRE(result.overhead_median == latency);
+    REQUIRE(result.overhead_maximum == latency);
+    REQUIRE(result.resolution == latency);
+    REQUIRE(result.repeated == 0);
+    REQUIRE(result.violations == 0);
+    REQUIRE(result.wraps == 0);
+    REQUIRE(result.bits == 64);
+}
+
+// Counts up in steps of 4, wraps around past 2^32 and then jumps back once on the tenth read
+struct wrapping_timer {
+    typedef uint32_t ticks_t;
+
+    ticks_t ticks = 0xFFFFFFF0;
+    ticks_t steps = 0;
+
+    ticks_t get_ticks(scat::chain_t& chain){
+        steps += 1;
+        ticks += 4;
+        return (steps == 10) ? 0 : ticks;
+    }
+};
+
+TEST_CASE("characterize tells wraps from violations"){
+    wrapping_timer timer;
+    scat::chain_t chain;
+
+    auto result = scat::timer::characterize(timer, 9, chain);
+    REQUIRE(result.bits == 32);
+    REQUIRE(result.wraps == 1);
+    REQUIRE(result.violations == 1);
+    REQUIRE(result.resolution == 4);
+    REQUIRE(result.wrap_period.count() > 0);
+}